@@ -0,0 +1,376 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cpp_magic {
+namespace parallel {
+
+// Background threads, each with its own deque of tasks.  A worker takes the
+// newest task of its own deque and, when that is empty, steals the oldest
+// one of another, so nested parallel loops stay on the thread that started
+// them until somebody is idle.  Threads that wait for their tasks run queued
+// tasks meanwhile instead of blocking, which makes waiting inside a task
+// safe.
+class thread_pool {
+public:
+	// One worker fewer than the hardware threads: the thread that starts a
+	// parallel loop works as well.
+	explicit thread_pool(size_t workers = default_worker_count()) : queues_(workers), pending_(0), stop_(false) {
+		for (auto& queue : queues_) {
+			queue.reset(new task_queue());
+		}
+		threads_.reserve(workers);
+		for (size_t index = 0; index < workers; ++index) {
+			threads_.emplace_back([this, index] { work(index); });
+		}
+	}
+
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	// Finishes the queued tasks, then joins the workers.
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (auto& thread : threads_) {
+			thread.join();
+		}
+	}
+
+	// The pool the parallel algorithms use when not given one.
+	static thread_pool& shared() {
+		static thread_pool pool;
+		return pool;
+	}
+
+	static size_t default_worker_count() {
+		const unsigned hardware = std::thread::hardware_concurrency();
+		return hardware > 1 ? hardware - 1 : 0;
+	}
+
+	size_t worker_count() const { return threads_.size(); }
+
+	// Queues task on the deque of the calling worker, or spreads tasks from
+	// other threads over the workers.  A pool without workers runs it at once.
+	void submit(std::function<void()> task) {
+		if (queues_.empty()) {
+			task();
+			return;
+		}
+		const worker_slot& slot = current_worker();
+		const size_t index = slot.pool == this ? slot.index : next_queue_++ % queues_.size();
+		{
+			std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+			queues_[index]->tasks.push_back(std::move(task));
+		}
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex_);
+			++pending_;
+		}
+		wake_.notify_one();
+	}
+
+	// Runs one queued task on the calling thread, preferring its own deque
+	// if it is a worker; false if there was none.
+	bool run_one() {
+		const worker_slot& slot = current_worker();
+		const size_t first = slot.pool == this ? slot.index : 0;
+		std::function<void()> task;
+		for (size_t offset = 0; offset < queues_.size(); ++offset) {
+			if (take((first + offset) % queues_.size(), offset == 0 && slot.pool == this, task)) {
+				task();
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	struct task_queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	struct worker_slot {
+		const thread_pool* pool;
+		size_t index;
+	};
+
+	static worker_slot& current_worker() {
+		static thread_local worker_slot slot = { nullptr, 0 };
+		return slot;
+	}
+
+	// The owner takes from the back, thieves from the front.
+	bool take(size_t index, bool own, std::function<void()>& task) {
+		task_queue& queue = *queues_[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) {
+			return false;
+		}
+		if (own) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+		else {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		--pending_;
+		return true;
+	}
+
+	void work(size_t index) {
+		current_worker() = { this, index };
+		for (;;) {
+			if (run_one()) {
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleep_mutex_);
+			wake_.wait(lock, [this] { return stop_ || pending_ > 0; });
+			if (stop_ && pending_ == 0) {
+				return;
+			}
+		}
+	}
+
+	std::vector<std::unique_ptr<task_queue>> queues_;
+	std::vector<std::thread> threads_;
+	std::atomic<size_t> next_queue_{ 0 };
+	// Tasks queued and not yet taken.
+	std::atomic<size_t> pending_;
+	bool stop_;
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+};
+
+namespace impl {
+
+// Tasks started together and waited for together.  The first exception a
+// task throws is rethrown by wait.
+class task_group {
+public:
+	explicit task_group(thread_pool& pool) : pool_(pool), remaining_(0) {}
+
+	template<typename F>
+	void run(F task) {
+		++remaining_;
+		pool_.submit([this, task] {
+			try {
+				task();
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!error_) {
+					error_ = std::current_exception();
+				}
+			}
+			finish();
+		});
+	}
+
+	// Helps with the queued tasks while any of the group is unfinished.  Once
+	// nothing is left to take, the remaining ones are all running elsewhere.
+	void wait() {
+		while (remaining_ > 0) {
+			if (!pool_.run_one()) {
+				std::unique_lock<std::mutex> lock(mutex_);
+				done_.wait(lock, [this] { return remaining_ == 0; });
+			}
+		}
+		// The last task may still be inside finish.
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (error_) {
+			std::rethrow_exception(error_);
+		}
+	}
+
+private:
+	void finish() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--remaining_ == 0) {
+			done_.notify_all();
+		}
+	}
+
+	thread_pool& pool_;
+	std::atomic<size_t> remaining_;
+	std::mutex mutex_;
+	std::condition_variable done_;
+	std::exception_ptr error_;
+};
+
+// A few chunks per thread, so that stealing can even out uneven ones; one
+// when the caller would run them all anyway.
+inline size_t max_chunks(const thread_pool& pool) {
+	return pool.worker_count() == 0 ? 1 : (pool.worker_count() + 1) * 4;
+}
+
+// Splits [0, count) into at most max_chunks consecutive chunks of at least
+// grain indices and calls body(chunk, begin, end) for each, the first chunk
+// on the calling thread.  Returns the number of chunks; the split depends
+// only on count, grain and the size of the pool.
+template<typename Body>
+size_t for_each_chunk(thread_pool& pool, size_t count, size_t grain, const Body& body) {
+	assert(grain > 0);
+	const size_t chunks = std::max<size_t>(std::min((count + grain - 1) / grain, max_chunks(pool)), 1);
+	if (chunks == 1) {
+		body(size_t(0), size_t(0), count);
+		return 1;
+	}
+	task_group group(pool);
+	for (size_t chunk = 1; chunk < chunks; ++chunk) {
+		group.run([&body, chunk, chunks, count] {
+			body(chunk, count * chunk / chunks, count * (chunk + 1) / chunks);
+		});
+	}
+	try {
+		body(size_t(0), size_t(0), count / chunks);
+	}
+	catch (...) {
+		try {
+			group.wait();
+		}
+		catch (...) {
+		}
+		throw;
+	}
+	group.wait();
+	return chunks;
+}
+
+template<typename Iterator>
+struct to_value {
+	typename std::iterator_traits<Iterator>::value_type operator()(
+		typename std::iterator_traits<Iterator>::reference row) const {
+		return row;
+	}
+};
+
+}  // namespace impl
+
+// Indices per chunk below which splitting costs more than it saves.
+const size_t default_grain = 1024;
+
+// Calls f(*it) for every it in [begin, end), in chunks of consecutive
+// elements spread over the pool.  The iterators must be random access, such
+// as those of zip over vectors or of a soa_vector, and f must be safe to
+// call concurrently on different elements.
+template<typename Iterator, typename F>
+void parallel_for(Iterator begin, Iterator end, F f,
+	size_t grain = default_grain, thread_pool& pool = thread_pool::shared()) {
+	impl::for_each_chunk(pool, static_cast<size_t>(end - begin), grain,
+		[begin, &f](size_t, size_t from, size_t to) {
+			const Iterator chunk_end = begin + to;
+			for (Iterator it = begin + from; it != chunk_end; ++it) {
+				f(*it);
+			}
+		});
+}
+
+template<typename Range, typename F>
+void parallel_for(Range&& range, F f, size_t grain = default_grain, thread_pool& pool = thread_pool::shared()) {
+	parallel_for(std::begin(range), std::end(range), std::move(f), grain, pool);
+}
+
+// init reduced with transform(*it) for every it in [begin, end).  reduce
+// must be associative; it need not be commutative, as chunk results are
+// combined in order, and the result does not depend on timing.
+template<typename Iterator, typename T, typename Reduce, typename Transform>
+T parallel_transform_reduce(Iterator begin, Iterator end, T init, Reduce reduce, Transform transform,
+	size_t grain = default_grain, thread_pool& pool = thread_pool::shared()) {
+	const size_t count = static_cast<size_t>(end - begin);
+	if (count == 0) {
+		return init;
+	}
+	std::vector<std::unique_ptr<T>> partials(impl::max_chunks(pool));
+	const size_t chunks = impl::for_each_chunk(pool, count, grain,
+		[begin, &reduce, &transform, &partials](size_t chunk, size_t from, size_t to) {
+			Iterator it = begin + from;
+			const Iterator chunk_end = begin + to;
+			std::unique_ptr<T> partial(new T(transform(*it)));
+			for (++it; it != chunk_end; ++it) {
+				*partial = reduce(std::move(*partial), transform(*it));
+			}
+			partials[chunk] = std::move(partial);
+		});
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		init = reduce(std::move(init), std::move(*partials[chunk]));
+	}
+	return init;
+}
+
+template<typename Range, typename T, typename Reduce, typename Transform>
+T parallel_transform_reduce(Range&& range, T init, Reduce reduce, Transform transform,
+	size_t grain = default_grain, thread_pool& pool = thread_pool::shared()) {
+	return parallel_transform_reduce(
+		std::begin(range), std::end(range), std::move(init), std::move(reduce), std::move(transform), grain, pool);
+}
+
+// Inclusive scan: out[i] = transform(begin[0]) op ... op transform(begin[i]).
+// Each chunk is reduced, the chunk totals are scanned, then each chunk is
+// scanned again from its offset, so the input is read twice.  op must be
+// associative.  out must be random access and may be begin when transform
+// gives the element type.
+template<typename Iterator, typename OutIterator, typename Op, typename Transform>
+OutIterator parallel_scan(Iterator begin, Iterator end, OutIterator out, Op op, Transform transform,
+	size_t grain = default_grain, thread_pool& pool = thread_pool::shared()) {
+	using T = typename std::decay<decltype(transform(*begin))>::type;
+	const size_t count = static_cast<size_t>(end - begin);
+	if (count == 0) {
+		return out;
+	}
+	std::vector<std::unique_ptr<T>> totals(impl::max_chunks(pool));
+	const size_t chunks = impl::for_each_chunk(pool, count, grain,
+		[begin, &op, &transform, &totals](size_t chunk, size_t from, size_t to) {
+			Iterator it = begin + from;
+			const Iterator chunk_end = begin + to;
+			std::unique_ptr<T> total(new T(transform(*it)));
+			for (++it; it != chunk_end; ++it) {
+				*total = op(std::move(*total), transform(*it));
+			}
+			totals[chunk] = std::move(total);
+		});
+	// totals[chunk] becomes the reduction of chunks 0 to chunk.
+	for (size_t chunk = 1; chunk < chunks; ++chunk) {
+		*totals[chunk] = op(*totals[chunk - 1], std::move(*totals[chunk]));
+	}
+	impl::for_each_chunk(pool, count, grain,
+		[begin, out, &op, &transform, &totals](size_t chunk, size_t from, size_t to) {
+			Iterator it = begin + from;
+			const Iterator chunk_end = begin + to;
+			OutIterator target = out + from;
+			T running = chunk == 0 ? transform(*it) : op(*totals[chunk - 1], transform(*it));
+			for (++it; it != chunk_end; ++it, ++target) {
+				T next = op(running, transform(*it));
+				*target = std::move(running);
+				running = std::move(next);
+			}
+			*target = std::move(running);
+		});
+	return out + count;
+}
+
+template<typename Iterator, typename OutIterator, typename Op>
+OutIterator parallel_scan(Iterator begin, Iterator end, OutIterator out, Op op) {
+	return parallel_scan(begin, end, out, std::move(op), impl::to_value<Iterator>());
+}
+
+}  // namespace parallel
+}  // namespace cpp_magic
@@ -0,0 +1,307 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#include "Zip.h"
+
+namespace cpp_magic {
+namespace soa {
+
+namespace impl {
+
+// Storage for count objects of type T, uninitialized, starting on a cache
+// line so a loop over a column can use aligned vector loads.
+template<typename T>
+T* allocate_column(size_t count) {
+	const size_t alignment = alignof(T) > 64 ? alignof(T) : 64;
+	if (count == 0) {
+		return nullptr;
+	}
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(count * sizeof(T), alignment);
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, alignment, count * sizeof(T)) != 0) {
+		memory = nullptr;
+	}
+#endif
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return static_cast<T*>(memory);
+}
+
+template<typename T>
+void free_column(T* column) {
+#ifdef _MSC_VER
+	_aligned_free(column);
+#else
+	free(column);
+#endif
+}
+
+// Calls f(std::integral_constant<size_t, I>()) for every I of the sequence,
+// in order, so a generic lambda can use the index as a constant.
+template<typename F, size_t... I>
+void for_each_index(std::index_sequence<I...>, F&& f) {
+	int ignored[] = { (f(std::integral_constant<size_t, I>()), 0)..., 0 };
+	(void)ignored;
+}
+
+}  // namespace impl
+
+// A column of a soa_vector: pointer and length, usable in range-for and
+// with raw-pointer loops.
+template<typename T>
+class column_view {
+public:
+	column_view(T* data, size_t size) : data_(data), size_(size) {}
+	T* data() const { return data_; }
+	size_t size() const { return size_; }
+	T* begin() const { return data_; }
+	T* end() const { return data_ + size_; }
+	T& operator[](size_t index) const {
+		assert(index < size_);
+		return data_[index];
+	}
+private:
+	T* data_;
+	size_t size_;
+};
+
+// Vector of records stored as a structure of arrays: field I of every row
+// is in column I, its own 64-byte aligned buffer, so a loop over one field
+// reads only that field and vectorizes.  All columns share one size and one
+// capacity and grow together, doubling.
+//
+// Rows are zip rows: begin(), end() and operator[] give
+// cpp_magic::zip::impl::zip_reference tuples of references, with random
+// access iterators that std::sort accepts.  column<I>() and data<I>() give
+// one field as a contiguous array.
+template<typename... Fields>
+class soa_vector {
+public:
+	static_assert(sizeof...(Fields) > 0, "at least one field");
+
+	using iterator = zip::impl::zip_iterator<Fields*...>;
+	using const_iterator = zip::impl::zip_iterator<const Fields*...>;
+	using reference = typename iterator::reference;
+	using const_reference = typename const_iterator::reference;
+	using value_type = std::tuple<Fields...>;
+
+	template<size_t I>
+	using field_type = typename std::tuple_element<I, std::tuple<Fields...>>::type;
+
+	soa_vector() : size_(0), capacity_(0), columns_() {}
+
+	explicit soa_vector(size_t size) : soa_vector() {
+		resize(size);
+	}
+
+	soa_vector(const soa_vector& other) : soa_vector() {
+		reserve(other.size_);
+		for (size_t row = 0; row < other.size_; ++row) {
+			push_back_row(other[row], std::index_sequence_for<Fields...>());
+		}
+	}
+
+	soa_vector(soa_vector&& other) noexcept
+		: size_(other.size_), capacity_(other.capacity_), columns_(other.columns_) {
+		other.size_ = 0;
+		other.capacity_ = 0;
+		other.columns_ = std::tuple<Fields*...>();
+	}
+
+	soa_vector& operator=(soa_vector other) {
+		swap(other);
+		return *this;
+	}
+
+	~soa_vector() {
+		clear();
+		release(columns_);
+	}
+
+	void swap(soa_vector& other) noexcept {
+		std::swap(size_, other.size_);
+		std::swap(capacity_, other.capacity_);
+		std::swap(columns_, other.columns_);
+	}
+
+	size_t size() const { return size_; }
+	size_t capacity() const { return capacity_; }
+	bool empty() const { return size_ == 0; }
+
+	void reserve(size_t capacity) {
+		if (capacity > capacity_) {
+			reallocate(capacity);
+		}
+	}
+
+	// New rows are value-initialized, as in std::vector.
+	void resize(size_t size) {
+		if (size > capacity_) {
+			reallocate(grown_capacity(size));
+		}
+		for (; size_ < size; ++size_) {
+			impl::for_each_index(std::index_sequence_for<Fields...>(), [this](auto index) {
+				using T = field_type<decltype(index)::value>;
+				new (std::get<decltype(index)::value>(columns_) + size_) T();
+			});
+		}
+		while (size_ > size) {
+			pop_back();
+		}
+	}
+
+	// One value per field, each forwarded to the constructor of its column.
+	template<typename... Values>
+	void push_back(Values&&... values) {
+		static_assert(sizeof...(Values) == sizeof...(Fields), "one value per field");
+		if (size_ == capacity_) {
+			// The values may refer into the old rows, so the new row is built
+			// before those are moved from.
+			reallocate(grown_capacity(size_ + 1), [&](std::tuple<Fields*...>& columns) {
+				construct_row(columns, size_, std::index_sequence_for<Fields...>(), std::forward<Values>(values)...);
+			});
+		}
+		else {
+			construct_row(columns_, size_, std::index_sequence_for<Fields...>(), std::forward<Values>(values)...);
+		}
+		++size_;
+	}
+
+	void pop_back() {
+		assert(size_ > 0);
+		--size_;
+		destroy_rows(columns_, size_, size_ + 1);
+	}
+
+	void clear() {
+		destroy_rows(columns_, 0, size_);
+		size_ = 0;
+	}
+
+	reference operator[](size_t row) {
+		assert(row < size_);
+		return begin()[row];
+	}
+	const_reference operator[](size_t row) const {
+		assert(row < size_);
+		return begin()[row];
+	}
+
+	iterator begin() { return make_iterator<iterator>(0, std::index_sequence_for<Fields...>()); }
+	iterator end() { return make_iterator<iterator>(size_, std::index_sequence_for<Fields...>()); }
+	const_iterator begin() const {
+		return make_iterator<const_iterator>(0, std::index_sequence_for<Fields...>());
+	}
+	const_iterator end() const {
+		return make_iterator<const_iterator>(size_, std::index_sequence_for<Fields...>());
+	}
+
+	template<size_t I>
+	field_type<I>* data() { return std::get<I>(columns_); }
+	template<size_t I>
+	const field_type<I>* data() const { return std::get<I>(columns_); }
+
+	template<size_t I>
+	column_view<field_type<I>> column() { return column_view<field_type<I>>(data<I>(), size_); }
+	template<size_t I>
+	column_view<const field_type<I>> column() const {
+		return column_view<const field_type<I>>(data<I>(), size_);
+	}
+
+private:
+	size_t grown_capacity(size_t needed) const {
+		return needed > capacity_ * 2 ? needed : capacity_ * 2;
+	}
+
+	void reallocate(size_t capacity) {
+		reallocate(capacity, [](std::tuple<Fields*...>&) {});
+	}
+
+	// Moves every column into a buffer of capacity rows.  before_move(new
+	// columns) runs first, while the old rows are still intact, as when
+	// std::vector builds an appended element before moving the others.  If
+	// allocation or before_move throws, the vector is left as it was; the
+	// fields' moves should not throw.
+	template<typename BeforeMove>
+	void reallocate(size_t capacity, const BeforeMove& before_move) {
+		std::tuple<Fields*...> columns;
+		try {
+			impl::for_each_index(std::index_sequence_for<Fields...>(), [capacity, &columns](auto index) {
+				constexpr size_t I = decltype(index)::value;
+				std::get<I>(columns) = impl::allocate_column<field_type<I>>(capacity);
+			});
+			before_move(columns);
+		}
+		catch (...) {
+			release(columns);
+			throw;
+		}
+		impl::for_each_index(std::index_sequence_for<Fields...>(), [this, &columns](auto index) {
+			constexpr size_t I = decltype(index)::value;
+			using T = field_type<I>;
+			T* column = std::get<I>(columns);
+			T* old = std::get<I>(columns_);
+			for (size_t row = 0; row < size_; ++row) {
+				new (column + row) T(std::move_if_noexcept(old[row]));
+			}
+		});
+		destroy_rows(columns_, 0, size_);
+		release(columns_);
+		columns_ = columns;
+		capacity_ = capacity;
+	}
+
+	template<size_t... I, typename... Values>
+	static void construct_row(
+		std::tuple<Fields*...>& columns, size_t row, std::index_sequence<I...>, Values&&... values) {
+		int ignored[] = { (new (std::get<I>(columns) + row) field_type<I>(std::forward<Values>(values)), 0)..., 0 };
+		(void)ignored;
+	}
+
+	template<typename Row, size_t... I>
+	void push_back_row(const Row& row, std::index_sequence<I...>) {
+		push_back(std::get<I>(row)...);
+	}
+
+	template<typename Iterator, size_t... I>
+	Iterator make_iterator(size_t row, std::index_sequence<I...>) const {
+		return Iterator((std::get<I>(columns_) + row)...);
+	}
+
+	static void destroy_rows(std::tuple<Fields*...>& columns, size_t from, size_t to) {
+		impl::for_each_index(std::index_sequence_for<Fields...>(), [&columns, from, to](auto index) {
+			using T = field_type<decltype(index)::value>;
+			T* column = std::get<decltype(index)::value>(columns);
+			for (size_t row = from; row < to; ++row) {
+				column[row].~T();
+			}
+		});
+	}
+
+	static void release(std::tuple<Fields*...>& columns) {
+		impl::for_each_index(std::index_sequence_for<Fields...>(), [&columns](auto index) {
+			impl::free_column(std::get<decltype(index)::value>(columns));
+			std::get<decltype(index)::value>(columns) = nullptr;
+		});
+	}
+
+	size_t size_;
+	size_t capacity_;
+	std::tuple<Fields*...> columns_;
+};
+
+}  // namespace soa
+}  // namespace cpp_magic
@@ -1,85 +1,209 @@
 #pragma once
-#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace cpp_magic {
 namespace zip {
 
 namespace impl {
 
+// What *it of a zip_iterator returns: a tuple of the component references,
+// so std::get and the tuple comparisons work on it, that also behaves like
+// a reference to a row.  Assigning to it assigns through to every component,
+// converting it to value_type copies the row out, and swap exchanges the
+// rows.  That is what std::sort and the other permuting algorithms need to
+// reorder several arrays together.
+//
+// *it is always a temporary, so std::move(*it) looks no different from a
+// plain *it that an algorithm only reads: rows are copied out of and into
+// the arrays, never moved, and only swap avoids the copies.
+template<typename... References>
+class zip_reference : public std::tuple<References...> {
+public:
+	using Base = std::tuple<References...>;
+	using value_type = std::tuple<typename std::decay<References>::type...>;
+
+	explicit zip_reference(References... references)
+		: Base(std::forward<References>(references)...)
+	{}
+	zip_reference(const zip_reference&) = default;
+
+	zip_reference& operator=(const zip_reference& other) {
+		assign(other, std::index_sequence_for<References...>());
+		return *this;
+	}
+	zip_reference& operator=(const value_type& other) {
+		assign(other, std::index_sequence_for<References...>());
+		return *this;
+	}
+	zip_reference& operator=(value_type&& other) {
+		move_assign(other, std::index_sequence_for<References...>());
+		return *this;
+	}
+
+	operator value_type() const {
+		return copy_row(std::index_sequence_for<References...>());
+	}
+
+	friend void swap(zip_reference left, zip_reference right) {
+		left.swap_rows(right, std::index_sequence_for<References...>());
+	}
+
+private:
+	template<typename Tuple, size_t... I>
+	void assign(const Tuple& other, std::index_sequence<I...>) {
+		int ignored[] = { (std::get<I>(*this) = std::get<I>(other), 0)..., 0 };
+		(void)ignored;
+	}
+
+	template<typename Tuple, size_t... I>
+	void move_assign(Tuple& other, std::index_sequence<I...>) {
+		int ignored[] = { (std::get<I>(*this) = std::move(std::get<I>(other)), 0)..., 0 };
+		(void)ignored;
+	}
+
+	template<size_t... I>
+	value_type copy_row(std::index_sequence<I...>) const {
+		return value_type(std::get<I>(*this)...);
+	}
+
+	template<size_t... I>
+	void swap_rows(zip_reference& other, std::index_sequence<I...>) {
+		using std::swap;
+		int ignored[] = { (swap(std::get<I>(*this), std::get<I>(other)), 0)..., 0 };
+		(void)ignored;
+	}
+};
+
+// Moves all the iterators together.  Its category is the weakest of theirs,
+// so zipping random access ranges gives a random access range that std::sort
+// and the parallel algorithms accept.
+//
+// Random access zip_iterators compare by their first component: zip gives
+// them a common end.  Weaker ones are equal when any component is, so a
+// loop stops at the end of the shortest range.
 template<typename... Iterators>
 class zip_iterator {
 public:
+	static_assert(sizeof...(Iterators) > 0, "zip at least one range");
+
 	using Self = zip_iterator<Iterators...>;
+	using iterator_category =
+		typename std::common_type<typename std::iterator_traits<Iterators>::iterator_category...>::type;
+	using value_type = std::tuple<typename std::iterator_traits<Iterators>::value_type...>;
+	using difference_type =
+		typename std::common_type<typename std::iterator_traits<Iterators>::difference_type...>::type;
+	using reference = zip_reference<typename std::iterator_traits<Iterators>::reference...>;
+	using pointer = void;
+
+	zip_iterator() = default;
+	zip_iterator(const Iterators&... iters)
+		: iters_(iters...)
+	{}
+
 	friend bool operator==(const Self& left, const Self& right) {
-		return any_equal_helper<>::call(left.iters_, right.iters_);
+		return equal(left, right, iterator_category(), std::index_sequence_for<Iterators...>());
 	}
 	friend bool operator!=(const Self& left, const Self& right) {
 		return !(left == right);
 	}
-	auto operator++() -> decltype(*this) {
-		increment_helper<>::call(iters_);
-		return (*this);
+
+	reference operator*() const {
+		return dereference(std::index_sequence_for<Iterators...>());
 	}
-	auto operator*() -> decltype(std::forward_as_tuple(*std::declval<Iterators>()...)) {
-		return dereference_helper<>::call(iters_);
+	reference operator[](difference_type offset) const {
+		return *(*this + offset);
 	}
-	zip_iterator(const Iterators&... iters)
-		: iters_(iters...)
-	{}
+
+	Self& operator++() {
+		advance(1, std::index_sequence_for<Iterators...>());
+		return *this;
+	}
+	Self operator++(int) {
+		Self old = *this;
+		++*this;
+		return old;
+	}
+	Self& operator--() {
+		advance(-1, std::index_sequence_for<Iterators...>());
+		return *this;
+	}
+	Self operator--(int) {
+		Self old = *this;
+		--*this;
+		return old;
+	}
+
+	Self& operator+=(difference_type offset) {
+		advance(offset, std::index_sequence_for<Iterators...>());
+		return *this;
+	}
+	Self& operator-=(difference_type offset) {
+		return *this += -offset;
+	}
+	friend Self operator+(Self iter, difference_type offset) {
+		return iter += offset;
+	}
+	friend Self operator+(difference_type offset, Self iter) {
+		return iter += offset;
+	}
+	friend Self operator-(Self iter, difference_type offset) {
+		return iter -= offset;
+	}
+	friend difference_type operator-(const Self& left, const Self& right) {
+		return std::get<0>(left.iters_) - std::get<0>(right.iters_);
+	}
+
+	friend bool operator<(const Self& left, const Self& right) {
+		return std::get<0>(left.iters_) < std::get<0>(right.iters_);
+	}
+	friend bool operator>(const Self& left, const Self& right) {
+		return right < left;
+	}
+	friend bool operator<=(const Self& left, const Self& right) {
+		return !(right < left);
+	}
+	friend bool operator>=(const Self& left, const Self& right) {
+		return !(left < right);
+	}
+
 	std::tuple<Iterators...> iters_;
+
 private:
-	template <int c = 0, bool at_end = (c >= sizeof...(Iterators))>
-	struct any_equal_helper {
-		static bool call(const std::tuple<Iterators...>&, const std::tuple<Iterators...>&) {
-			return false;
-		}
-	};
-
-	template <int c>
-	struct any_equal_helper<c, false> {
-		static bool call(const std::tuple<Iterators...>& left, const std::tuple<Iterators...>& right) {
-			return std::get<c>(left) == std::get<c>(right) || any_equal_helper<c + 1>::call(left, right);
-		}
-	};
-
-	template <int c = 0, bool at_end = (c >= sizeof...(Iterators))>
-	struct increment_helper {
-		static void call(std::tuple<Iterators...>&) {
-			return;
-		}
-	};
-
-	template <int c>
-	struct increment_helper<c, false> {
-		static void call(std::tuple<Iterators...>& param) {
-			++std::get<c>(param);
-			increment_helper<c + 1>::call(param);
-		}
-	};
-
-	template <int c = 0, bool at_end = (c >= sizeof...(Iterators))>
-	struct dereference_helper {
-		static std::tuple<> call(std::tuple<Iterators...>&) {
-			return std::forward_as_tuple();
-		}
-	};
-
-	template <int c>
-	struct dereference_helper<c, false> {
-		static auto call(std::tuple<Iterators...>& param) {
-			return std::tuple_cat(std::forward_as_tuple(*std::get<c>(param)), dereference_helper<c+1>::call(param));
-		}
-	};
+	template<size_t... I>
+	static bool equal(const Self& left, const Self& right, std::random_access_iterator_tag, std::index_sequence<I...>) {
+		return std::get<0>(left.iters_) == std::get<0>(right.iters_);
+	}
+
+	template<size_t... I>
+	static bool equal(const Self& left, const Self& right, std::input_iterator_tag, std::index_sequence<I...>) {
+		const bool equal_components[] = { (std::get<I>(left.iters_) == std::get<I>(right.iters_))... };
+		return std::find(std::begin(equal_components), std::end(equal_components), true) != std::end(equal_components);
+	}
+
+	template<size_t... I>
+	reference dereference(std::index_sequence<I...>) const {
+		return reference(*std::get<I>(iters_)...);
+	}
+
+	template<size_t... I>
+	void advance(difference_type offset, std::index_sequence<I...>) {
+		int ignored[] = { (std::advance(std::get<I>(iters_), offset), 0)..., 0 };
+		(void)ignored;
+	}
 };
 
 template<typename... Containers>
 class zip_container_type {
 public:
-	using iterator = zip_iterator<decltype(std::begin(std::declval<Containers>()))...>;
+	using iterator = zip_iterator<decltype(std::begin(std::declval<Containers&>()))...>;
 	zip_container_type(Containers&... containers):
 		begin_(iterator(std::begin(containers)...)),
-		end_(iterator(std::end(containers)...))
+		end_(make_end(typename iterator::iterator_category(), containers...))
 	{}
 	iterator begin() const {
 		return begin_;
@@ -88,6 +212,18 @@ public:
 		return end_;
 	}
 private:
+	// Random access ranges all end at the length of the shortest one.
+	iterator make_end(std::random_access_iterator_tag, Containers&... containers) const {
+		const typename iterator::difference_type lengths[] = {
+			static_cast<typename iterator::difference_type>(std::end(containers) - std::begin(containers))...
+		};
+		return begin_ + *std::min_element(std::begin(lengths), std::end(lengths));
+	}
+
+	iterator make_end(std::input_iterator_tag, Containers&... containers) const {
+		return iterator(std::end(containers)...);
+	}
+
 	iterator begin_, end_;
 };
 
@@ -99,4 +235,4 @@ impl::zip_container_type<Containers...> zip(Containers&... containers) {
 }
 
 }  // namespace zip
-}  // namespace cpp_magic
\ No newline at end of file
+}  // namespace cpp_magic
@@ -0,0 +1,95 @@
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include "CppUnitTest.h"
+#include "../CppMagic/Parallel.h"
+#include "../CppMagic/SoaVector.h"
+#include "../CppMagic/Zip.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace CppMagicTests
+{
+TEST_CLASS(ParallelTest)
+{
+public:
+
+	TEST_METHOD(TestParallelForOverZip) {
+		using namespace cpp_magic::parallel;
+		using namespace cpp_magic::zip;
+		thread_pool pool(3);
+		std::vector<int> a(10000), b(10000), c(10000);
+		std::iota(a.begin(), a.end(), 0);
+		std::iota(b.begin(), b.end(), 5);
+		parallel_for(zip(a, b, c), [](auto row) {
+			std::get<2>(row) = std::get<0>(row) * std::get<1>(row);
+		}, 100, pool);
+		for (int i = 0; i < 10000; ++i) {
+			Assert::AreEqual(i * (i + 5), c[i]);
+		}
+
+		cpp_magic::soa::soa_vector<int, long long> records;
+		for (int i = 0; i < 5000; ++i) {
+			records.push_back(i, 0);
+		}
+		// Nested loops wait inside tasks of the same pool.
+		parallel_for(records.begin(), records.end(), [&pool](auto row) {
+			const std::vector<int> ones(50, 1);
+			const long long sum = parallel_transform_reduce(ones, 0LL, std::plus<long long>(), [](int one) {
+				return static_cast<long long>(one);
+			}, 10, pool);
+			std::get<1>(row) = std::get<0>(row) + sum;
+		}, 64, pool);
+		Assert::AreEqual(4999LL + 50, std::get<1>(records[4999]));
+
+		Assert::ExpectException<std::runtime_error>([&pool, &a] {
+			parallel_for(a, [](int value) {
+				if (value == 7777) {
+					throw std::runtime_error("element");
+				}
+			}, 100, pool);
+		});
+	}
+
+	TEST_METHOD(TestTransformReduceAndScan) {
+		using namespace cpp_magic::parallel;
+		using namespace cpp_magic::zip;
+		thread_pool pool(3);
+		std::vector<long long> a(10001), b(10001);
+		std::iota(a.begin(), a.end(), 1);
+		std::iota(b.begin(), b.end(), 3);
+		auto zipped = zip(a, b);
+		const long long dot = parallel_transform_reduce(zipped, 10LL, std::plus<long long>(), [](auto row) {
+			return std::get<0>(row) * std::get<1>(row);
+		}, 100, pool);
+		Assert::AreEqual(std::inner_product(a.begin(), a.end(), b.begin(), 10LL), dot);
+
+		// Chunks are combined in order, so a non-commutative reduce works.
+		std::vector<int> digits(3000, 0);
+		for (size_t i = 0; i < digits.size(); ++i) {
+			digits[i] = static_cast<int>(i % 10);
+		}
+		const std::vector<int> concatenated = parallel_transform_reduce(digits.begin(), digits.end(), std::vector<int>(),
+			[](std::vector<int> left, const std::vector<int>& right) {
+				left.insert(left.end(), right.begin(), right.end());
+				return left;
+			},
+			[](int digit) { return std::vector<int>(1, digit); }, 50, pool);
+		Assert::IsTrue(digits == concatenated);
+
+		std::vector<long long> prefix(a.size());
+		parallel_scan(zipped.begin(), zipped.end(), prefix.begin(), std::plus<long long>(), [](auto row) {
+			return std::get<0>(row) - std::get<1>(row);
+		}, 100, pool);
+		for (size_t i = 0; i < prefix.size(); ++i) {
+			Assert::AreEqual(-2LL * static_cast<long long>(i + 1), prefix[i]);
+		}
+
+		parallel_scan(a.begin(), a.end(), a.begin(), std::plus<long long>());
+		Assert::AreEqual(10001LL * 10002 / 2, a.back());
+		Assert::AreEqual(3LL, a[1]);
+	}
+};
+}
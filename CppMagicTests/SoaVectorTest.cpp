@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "CppUnitTest.h"
+#include "../CppMagic/SoaVector.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace CppMagicTests
+{
+TEST_CLASS(SoaVectorTest)
+{
+public:
+
+	TEST_METHOD(TestPushBackAndColumns) {
+		using namespace cpp_magic::soa;
+		soa_vector<int, double, std::string> records;
+		for (int i = 0; i < 100; ++i) {
+			records.push_back(i, i * 0.5, std::to_string(i));
+		}
+		Assert::AreEqual(size_t(100), records.size());
+		Assert::IsTrue(records.capacity() >= records.size());
+		Assert::AreEqual(size_t(0), reinterpret_cast<std::uintptr_t>(records.data<1>()) % 64);
+
+		double sum = 0;
+		for (double value : records.column<1>()) {
+			sum += value;
+		}
+		Assert::AreEqual(2475.0, sum);
+		Assert::AreEqual(std::string("42"), records.column<2>()[42]);
+
+		std::get<0>(records[3]) = 1000;
+		Assert::AreEqual(1000, records.data<0>()[3]);
+
+		records.pop_back();
+		records.resize(120);
+		Assert::AreEqual(size_t(120), records.size());
+		Assert::AreEqual(0, std::get<0>(records[110]));
+		Assert::AreEqual(std::string(), std::get<2>(records[110]));
+		records.resize(10);
+		records.reserve(1000);
+		Assert::AreEqual(size_t(10), records.size());
+		Assert::AreEqual(std::string("9"), std::get<2>(records[9]));
+
+		// Arguments referring into the vector survive its growth, which
+		// happens at rows 1, 2, 4 and 8.
+		soa_vector<std::string, int> strings;
+		strings.push_back(std::string(50, 'a'), 7);
+		for (int i = 0; i < 10; ++i) {
+			strings.push_back(std::get<0>(strings[i]), std::get<1>(strings[i]));
+		}
+		Assert::AreEqual(size_t(11), strings.size());
+		for (size_t row = 0; row < strings.size(); ++row) {
+			Assert::AreEqual(std::string(50, 'a'), std::get<0>(strings[row]));
+			Assert::AreEqual(7, std::get<1>(strings[row]));
+		}
+	}
+
+	TEST_METHOD(TestRowsSortAndCopy) {
+		using namespace cpp_magic::soa;
+		soa_vector<int, std::string> records;
+		records.push_back(3, "c");
+		records.push_back(1, "a");
+		records.push_back(2, "b");
+		std::sort(records.begin(), records.end());
+		std::vector<std::tuple<int, std::string>> rows;
+		for (auto row : records) {
+			rows.push_back(row);
+		}
+		const std::vector<std::tuple<int, std::string>> expected = { { 1, "a" }, { 2, "b" }, { 3, "c" } };
+		Assert::IsTrue(expected == rows);
+
+		soa_vector<int, std::string> copy(records);
+		std::get<1>(copy[0]) = "changed";
+		Assert::AreEqual(std::string("a"), std::get<1>(records[0]));
+		soa_vector<int, std::string> moved(std::move(copy));
+		Assert::AreEqual(std::string("changed"), std::get<1>(moved[0]));
+		records = moved;
+		const soa_vector<int, std::string>& view = records;
+		Assert::AreEqual(std::string("changed"), std::get<1>(view[0]));
+		Assert::AreEqual(3, static_cast<int>(view.end() - view.begin()));
+	}
+};
+}
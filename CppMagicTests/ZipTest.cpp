@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <list>
+#include <string>
 #include <vector>
 #include <tuple>
 #include "CppUnitTest.h"
@@ -35,5 +38,50 @@ public:
 			Assert::IsTrue(std::get<0>(tup) == std::get<1>(tup));
 		}
 	}
+
+	TEST_METHOD(TestRandomAccess) {
+		using namespace cpp_magic::zip;
+		std::vector<int> keys = { 3, 1, 2, 5, 4 };
+		std::vector<std::string> names = { "c", "a", "b", "e", "d", "unused" };
+		auto z = zip(keys, names);
+		Assert::AreEqual(5, static_cast<int>(z.end() - z.begin()));
+		Assert::IsTrue(z.begin() < z.end());
+		Assert::AreEqual(std::string("e"), std::get<1>(z.begin()[3]));
+		auto it = z.begin();
+		it += 4;
+		Assert::AreEqual(4, std::get<0>(*it));
+		it -= 2;
+		Assert::AreEqual(2, std::get<0>(*it));
+		Assert::IsTrue(it + 3 == z.end());
+
+		std::sort(z.begin(), z.end());
+		Assert::IsTrue(keys == std::vector<int>({ 1, 2, 3, 4, 5 }));
+		Assert::IsTrue(names == std::vector<std::string>({ "a", "b", "c", "d", "e", "unused" }));
+
+		std::stable_sort(z.begin(), z.end(), [](const std::tuple<int, std::string>& left, const std::tuple<int, std::string>& right) {
+			return std::get<0>(left) % 2 < std::get<0>(right) % 2;
+		});
+		Assert::IsTrue(keys == std::vector<int>({ 2, 4, 1, 3, 5 }));
+		Assert::IsTrue(names == std::vector<std::string>({ "b", "d", "a", "c", "e", "unused" }));
+
+		swap(*z.begin(), *(z.end() - 1));
+		Assert::AreEqual(5, keys[0]);
+		Assert::AreEqual(std::string("b"), names[4]);
+		*z.begin() = std::make_tuple(7, std::string("g"));
+		Assert::AreEqual(std::string("g"), names[0]);
+	}
+
+	TEST_METHOD(TestShortestBidirectional) {
+		using namespace cpp_magic::zip;
+		std::list<int> list = { 1, 2, 3 };
+		std::vector<int> vector = { 10, 20, 30, 40 };
+		int count = 0;
+		for (auto tup : zip(list, vector)) {
+			std::get<0>(tup) += std::get<1>(tup);
+			++count;
+		}
+		Assert::AreEqual(3, count);
+		Assert::IsTrue(list == std::list<int>({ 11, 22, 33 }));
+	}
 };
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+namespace impl {
+
+// node = op(node, data) as one atomic step.  Returns false when the node was
+// left as it was and, for the operations where that means so, its
+// ancestors need no update either.
+template<class Data, class Op>
+bool AtomicApply(std::atomic<Data>& node, const Data& data, const Op& op) {
+	Data current = node.load(std::memory_order_relaxed);
+	while (!node.compare_exchange_weak(
+		current, op(current, data), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+	}
+	return true;
+}
+
+template<class T>
+typename std::enable_if<std::is_integral<T>::value, bool>::type
+AtomicApply(std::atomic<T>& node, const T& data, const SumOp<T>&) {
+	node.fetch_add(data, std::memory_order_acq_rel);
+	return true;
+}
+
+// An ancestor is never above its descendants, so once a node is already at
+// most data, so is everything above it.
+template<class T>
+bool AtomicApply(std::atomic<T>& node, const T& data, const MinOp<T>&) {
+	T current = node.load(std::memory_order_relaxed);
+	while (data < current) {
+		if (node.compare_exchange_weak(current, data, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+template<class T>
+bool AtomicApply(std::atomic<T>& node, const T& data, const MaxOp<T>&) {
+	T current = node.load(std::memory_order_relaxed);
+	while (current < data) {
+		if (node.compare_exchange_weak(current, data, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// InverseOp of a tree whose Op cannot be undone; SetAt does not compile
+// with it.
+struct NoInverseOp {};
+
+// The default InverseOp: a difference for sums, none for anything else.
+template<class Data, class Op>
+struct DefaultInverseOp {
+	using type = NoInverseOp;
+};
+
+template<class Data>
+struct DefaultInverseOp<Data, SumOp<Data>> {
+	using type = DifferenceOp<Data>;
+};
+
+}  // namespace impl
+
+// Segment tree that any number of threads may query and update at once,
+// without locks.  Op must be commutative, like the is_commutative path of
+// BasicIntervalTree::AddAt: an update folds its value into the leaf and
+// every ancestor with one atomic read-modify-write each (a fetch_add for
+// integer sums, a compare-exchange loop otherwise) and nothing is ever
+// recomputed from children.  Data must be trivially copyable.
+//
+// A query reads one node per ancestor path, so it sees every single update
+// either whole or not at all; it is not a snapshot of the tree as a whole
+// while updates are running.
+//
+// SetAt additionally needs InverseOp to undo Op (a difference for sums, xor
+// for xor): the leaf is exchanged and the ancestors get the difference.  It
+// defaults to DifferenceOp for SumOp only; for other operations SetAt does
+// not compile unless an inverse is given.  Trees over MinOp or MaxOp only
+// support AddAt, which moves a value towards the minimum (maximum) and stops
+// early at the first ancestor that is already there.
+//
+// The leaves start at the next power of two, as in BasicIntervalTree.
+// FillFrom must not run concurrently with anything else.
+template<
+	class Data,
+	class Op = SumOp<Data>,
+	class InverseOp = typename impl::DefaultInverseOp<Data, Op>::type>
+class ConcurrentIntervalTree : private impl::OperationHolder<Op> {
+public:
+	static_assert(std::is_trivially_copyable<Data>::value, "Data is stored in std::atomic");
+
+	ConcurrentIntervalTree(
+		size_t size,
+		const Data& default_value,
+		Op op = Op(),
+		InverseOp inverse = InverseOp())
+		: impl::OperationHolder<Op>(std::move(op))
+		, inverse_(std::move(inverse))
+		, size_(size)
+		, capacity_(impl::CeilPowerOfTwo(size))
+		, tree_(capacity_ * 2) {
+		assert(size > 0);
+		for (size_t offset = capacity_; offset < capacity_ * 2; ++offset) {
+			tree_[offset].store(default_value, std::memory_order_relaxed);
+		}
+		RecomputeAll();
+	}
+
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		assert(static_cast<size_t>(std::distance(begin, end)) <= size_);
+		size_t offset = capacity_;
+		for (Iter it = begin; it != end; ++it, ++offset) {
+			tree_[offset].store(*it, std::memory_order_relaxed);
+		}
+		RecomputeAll();
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	void AddAt(size_t offset, const Data& data) {
+		assert(offset < size_);
+		for (offset += capacity_; offset != 0; offset /= 2) {
+			if (!impl::AtomicApply(tree_[offset], data, this->operation())) {
+				break;
+			}
+		}
+	}
+
+	void SetAt(size_t offset, const Data& data) {
+		static_assert(!std::is_same<InverseOp, impl::NoInverseOp>::value, "SetAt needs an InverseOp that undoes Op");
+		assert(offset < size_);
+		offset += capacity_;
+		const Data old = tree_[offset].exchange(data, std::memory_order_acq_rel);
+		const Data difference = inverse_(data, old);
+		for (offset /= 2; offset != 0; offset /= 2) {
+			impl::AtomicApply(tree_[offset], difference, this->operation());
+		}
+	}
+
+	Data At(size_t offset) const {
+		assert(offset < size_);
+		return tree_[offset + capacity_].load(std::memory_order_acquire);
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(size_t left, size_t right) const {
+		assert(right < size_);
+		assert(left <= right);
+		left += capacity_;
+		right += capacity_;
+		Data result = Load(left++);
+		if (left > right) {
+			return result;
+		}
+		result = this->operation()(result, Load(right));
+		for (; left < right; left /= 2, right /= 2) {
+			if (left % 2 == 1) {
+				result = this->operation()(result, Load(left++));
+			}
+			if (right % 2 == 1) {
+				result = this->operation()(result, Load(--right));
+			}
+		}
+		return result;
+	}
+
+	size_t size() const { return size_; }
+
+private:
+	Data Load(size_t offset) const {
+		return tree_[offset].load(std::memory_order_acquire);
+	}
+
+	void RecomputeAll() {
+		for (size_t offset = capacity_ - 1; offset != 0; --offset) {
+			tree_[offset].store(
+				this->operation()(
+					tree_[offset * 2].load(std::memory_order_relaxed),
+					tree_[offset * 2 + 1].load(std::memory_order_relaxed)),
+				std::memory_order_relaxed);
+		}
+	}
+
+	InverseOp inverse_;
+	size_t size_;
+	size_t capacity_;
+	std::vector<std::atomic<Data>> tree_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
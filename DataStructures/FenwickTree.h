@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+// Binary indexed tree for a commutative Op with an inverse (sums, xors,
+// products of non-zero rationals): n + 1 nodes in a flat array, point updates
+// and prefix reductions in O(log n), each a short loop without recursion or
+// indirect calls.  A range reduction is the inverse of two prefix ones.
+//
+// Internally 1-based: node i covers the elements (i - lowbit(i), i].
+template<class Data, class Op = SumOp<Data>, class InverseOp = DifferenceOp<Data>>
+class FenwickTree : private impl::OperationHolder<Op> {
+public:
+	using Operation = Op;
+
+	explicit FenwickTree(
+		size_t size,
+		const Data& identity = Data(),
+		Op op = Op(),
+		InverseOp inverse = InverseOp())
+		: impl::OperationHolder<Op>(std::move(op))
+		, inverse_(std::move(inverse))
+		, identity_(identity)
+		, tree_(size + 1, identity) {
+		high_bit_ = 1;
+		while (high_bit_ * 2 <= size) {
+			high_bit_ *= 2;
+		}
+	}
+
+	// O(n): every node passes its total to the one node above it.
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		assert(static_cast<size_t>(std::distance(begin, end)) <= size());
+		std::fill(tree_.begin(), tree_.end(), identity_);
+		std::copy(begin, end, tree_.begin() + 1);
+		const size_t count = size();
+		for (size_t i = 1; i <= count; ++i) {
+			const size_t parent = i + LowBit(i);
+			if (parent <= count) {
+				tree_[parent] = this->operation()(tree_[parent], tree_[i]);
+			}
+		}
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	void AddAt(size_t offset, const Data& data) {
+		assert(offset < size());
+		for (size_t i = offset + 1; i < tree_.size(); i += LowBit(i)) {
+			tree_[i] = this->operation()(tree_[i], data);
+		}
+	}
+
+	void SetAt(size_t offset, const Data& data) {
+		AddAt(offset, inverse_(data, At(offset)));
+	}
+
+	Data At(size_t offset) const {
+		return RangeReduce(offset, offset);
+	}
+
+	// Reduction of the first count elements; the identity for 0.
+	Data PrefixReduce(size_t count) const {
+		assert(count <= size());
+		Data result = identity_;
+		for (; count != 0; count -= LowBit(count)) {
+			result = this->operation()(result, tree_[count]);
+		}
+		return result;
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(size_t left, size_t right) const {
+		assert(left <= right);
+		assert(right < size());
+		return inverse_(PrefixReduce(right + 1), PrefixReduce(left));
+	}
+
+	// The first offset whose prefix reduction PrefixReduce(offset + 1) is not
+	// less than value, or size() if there is none; O(log n) by descending the
+	// implicit tree.  Prefix reductions must not decrease (non-negative sums).
+	size_t LowerBound(const Data& value) const {
+		size_t position = 0;
+		Data prefix = identity_;
+		for (size_t step = high_bit_; step != 0; step /= 2) {
+			if (position + step < tree_.size()) {
+				Data next = this->operation()(prefix, tree_[position + step]);
+				if (next < value) {
+					position += step;
+					prefix = std::move(next);
+				}
+			}
+		}
+		return position;
+	}
+
+	size_t size() const { return tree_.size() - 1; }
+
+private:
+	static size_t LowBit(size_t i) { return i & (~i + 1); }
+
+	InverseOp inverse_;
+	Data identity_;
+	size_t high_bit_;
+	std::vector<Data> tree_;
+};
+
+namespace impl {
+
+// A node of RangeAddFenwickTree: both trees in one array, so an update or a
+// query touches one cache line per level instead of two.
+template<class Data>
+struct SlopeAndOffset {
+	Data slope;
+	Data offset;
+
+	SlopeAndOffset operator+(const SlopeAndOffset& other) const {
+		return SlopeAndOffset{ slope + other.slope, offset + other.offset };
+	}
+	SlopeAndOffset operator-(const SlopeAndOffset& other) const {
+		return SlopeAndOffset{ slope - other.slope, offset - other.offset };
+	}
+};
+
+}  // namespace impl
+
+// Range add and range sum over a numeric Data, the two-tree scheme kept in
+// one Fenwick tree of pairs.  With slopes the sum of slope[k] over k < count
+// and offsets the sum of offset[k], the first count elements sum to
+// slopes * count - offsets.  Adding x to [left, right] adds x to
+// slope[left] and x * left to offset[left], and takes both back at
+// right + 1.
+template<class Data>
+class RangeAddFenwickTree {
+public:
+	explicit RangeAddFenwickTree(size_t size)
+		: tree_(size, Node{ Data(), Data() }) {}
+
+	// O(n); the initial elements only go into the offsets.
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		std::vector<Node> nodes;
+		nodes.reserve(std::distance(begin, end));
+		for (Iter it = begin; it != end; ++it) {
+			nodes.push_back(Node{ Data(), -static_cast<Data>(*it) });
+		}
+		tree_.FillFrom(nodes);
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	// left and right - inclusive
+	void RangeAdd(size_t left, size_t right, const Data& data) {
+		assert(left <= right);
+		assert(right < size());
+		tree_.AddAt(left, Node{ data, data * static_cast<Data>(left) });
+		if (right + 1 < size()) {
+			tree_.AddAt(right + 1, Node{ -data, -data * static_cast<Data>(right + 1) });
+		}
+	}
+
+	void AddAt(size_t offset, const Data& data) {
+		RangeAdd(offset, offset, data);
+	}
+
+	// Sum of the first count elements.
+	Data PrefixSum(size_t count) const {
+		const Node prefix = tree_.PrefixReduce(count);
+		return prefix.slope * static_cast<Data>(count) - prefix.offset;
+	}
+
+	// left and right - inclusive
+	Data RangeSum(size_t left, size_t right) const {
+		assert(left <= right);
+		assert(right < size());
+		return PrefixSum(right + 1) - PrefixSum(left);
+	}
+
+	size_t size() const { return tree_.size(); }
+
+private:
+	using Node = impl::SlopeAndOffset<Data>;
+	FenwickTree<Node> tree_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+// Segment tree over a rows x columns grid: point updates and rectangle
+// reductions in O(log rows * log columns).  A segment tree over the rows
+// whose nodes are segment trees over the columns, all 2 rows x 2 columns
+// nodes in one array, row node r at r * 2 * columns, so a query or update
+// never leaves the array and Op is called directly.
+//
+// The loops are the bottom-up ones of the Compact layout: Op must be
+// commutative (sums, xors, min, max) and identity its identity.
+template<class Data, class Op>
+class GridIntervalTree : private impl::OperationHolder<Op> {
+public:
+	using Operation = Op;
+
+	GridIntervalTree(size_t rows, size_t columns, const Data& identity, Op op = Op())
+		: impl::OperationHolder<Op>(std::move(op))
+		, rows_(rows)
+		, columns_(columns)
+		, identity_(identity)
+		, tree_(rows * 2 * columns * 2, identity) {
+		assert(rows > 0 && columns > 0);
+	}
+
+	// Row by row, rows() * columns() values at most; the rest of the grid
+	// becomes the identity.
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		assert(static_cast<size_t>(std::distance(begin, end)) <= rows_ * columns_);
+		std::fill(tree_.begin(), tree_.end(), identity_);
+		Iter it = begin;
+		for (size_t row = 0; row < rows_ && it != end; ++row) {
+			Data* node = Row(rows_ + row);
+			for (size_t column = 0; column < columns_ && it != end; ++column, ++it) {
+				node[columns_ + column] = *it;
+			}
+		}
+		for (size_t row = rows_; row < rows_ * 2; ++row) {
+			Data* node = Row(row);
+			for (size_t column = columns_ - 1; column != 0; --column) {
+				node[column] = this->operation()(node[column * 2], node[column * 2 + 1]);
+			}
+		}
+		for (size_t row = rows_ - 1; row != 0; --row) {
+			Data* node = Row(row);
+			const Data* first = Row(row * 2);
+			const Data* second = Row(row * 2 + 1);
+			for (size_t column = 1; column < columns_ * 2; ++column) {
+				node[column] = this->operation()(first[column], second[column]);
+			}
+		}
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	void SetAt(size_t row, size_t column, const Data& data) {
+		assert(row < rows_ && column < columns_);
+		row += rows_;
+		column += columns_;
+		Data* leaf_row = Row(row);
+		leaf_row[column] = data;
+		for (size_t node = column / 2; node != 0; node /= 2) {
+			leaf_row[node] = this->operation()(leaf_row[node * 2], leaf_row[node * 2 + 1]);
+		}
+		for (row /= 2; row != 0; row /= 2) {
+			Data* node = Row(row);
+			const Data* first = Row(row * 2);
+			const Data* second = Row(row * 2 + 1);
+			for (size_t offset = column; offset != 0; offset /= 2) {
+				node[offset] = this->operation()(first[offset], second[offset]);
+			}
+		}
+	}
+
+	// Folds data into the element and every node above it, without reading
+	// any sibling.
+	void AddAt(size_t row, size_t column, const Data& data) {
+		assert(row < rows_ && column < columns_);
+		for (row += rows_; row != 0; row /= 2) {
+			Data* node = Row(row);
+			for (size_t offset = column + columns_; offset != 0; offset /= 2) {
+				node[offset] = this->operation()(node[offset], data);
+			}
+		}
+	}
+
+	Data At(size_t row, size_t column) const {
+		assert(row < rows_ && column < columns_);
+		return Row(row + rows_)[column + columns_];
+	}
+
+	// Rows top to bottom and columns left to right, all inclusive.
+	Data RangeReduce(size_t top, size_t left, size_t bottom, size_t right) const {
+		assert(top <= bottom && bottom < rows_);
+		assert(left <= right && right < columns_);
+		Data result = identity_;
+		for (top += rows_, bottom += rows_ + 1; top < bottom; top /= 2, bottom /= 2) {
+			if (top % 2 == 1) {
+				result = this->operation()(result, ReduceRow(top++, left, right));
+			}
+			if (bottom % 2 == 1) {
+				result = this->operation()(result, ReduceRow(--bottom, left, right));
+			}
+		}
+		return result;
+	}
+
+	size_t rows() const { return rows_; }
+	size_t columns() const { return columns_; }
+
+private:
+	Data* Row(size_t row) { return tree_.data() + row * columns_ * 2; }
+	const Data* Row(size_t row) const { return tree_.data() + row * columns_ * 2; }
+
+	Data ReduceRow(size_t row, size_t left, size_t right) const {
+		const Data* node = Row(row);
+		Data result = identity_;
+		for (left += columns_, right += columns_ + 1; left < right; left /= 2, right /= 2) {
+			if (left % 2 == 1) {
+				result = this->operation()(result, node[left++]);
+			}
+			if (right % 2 == 1) {
+				result = this->operation()(result, node[--right]);
+			}
+		}
+		return result;
+	}
+
+	size_t rows_;
+	size_t columns_;
+	Data identity_;
+	std::vector<Data> tree_;
+};
+
+// Fenwick tree over a sparse set of points known in advance, for
+// coordinates too large or too many for a grid: memory and build are
+// O(p log p) for p points, AddAt and RangeReduce O(log^2 p).
+//
+// Fenwick node i over the sorted distinct x holds a Fenwick tree over the
+// sorted distinct y of the points it covers.  All these inner trees are
+// stored back to back in one array, with their y next to them in another.
+// Op and InverseOp are as in FenwickTree.
+template<
+	class Data,
+	class Coordinate = long long,
+	class Op = SumOp<Data>,
+	class InverseOp = DifferenceOp<Data>>
+class CompressedGridFenwickTree : private impl::OperationHolder<Op> {
+public:
+	using Operation = Op;
+
+	// Every point later passed to AddAt or SetAt must be among the (x, y)
+	// pairs of [begin, end), which is read three times; repeats are fine.
+	template<class PointIter>
+	CompressedGridFenwickTree(
+		PointIter begin,
+		PointIter end,
+		const Data& identity = Data(),
+		Op op = Op(),
+		InverseOp inverse = InverseOp())
+		: impl::OperationHolder<Op>(std::move(op))
+		, inverse_(std::move(inverse))
+		, identity_(identity) {
+		for (PointIter it = begin; it != end; ++it) {
+			xs_.push_back(it->first);
+		}
+		std::sort(xs_.begin(), xs_.end());
+		xs_.erase(std::unique(xs_.begin(), xs_.end()), xs_.end());
+
+		// Counting pass, then every y into the slices of the nodes above its
+		// x, then each slice sorted and deduplicated in place.
+		begins_.assign(xs_.size() + 2, 0);
+		for (PointIter it = begin; it != end; ++it) {
+			for (size_t node = XIndex(it->first) + 1; node <= xs_.size(); node += LowBit(node)) {
+				++begins_[node + 1];
+			}
+		}
+		for (size_t node = 1; node < begins_.size(); ++node) {
+			begins_[node] += begins_[node - 1];
+		}
+		ys_.resize(begins_.back());
+		std::vector<size_t> filled(begins_.begin(), begins_.end() - 1);
+		for (PointIter it = begin; it != end; ++it) {
+			for (size_t node = XIndex(it->first) + 1; node <= xs_.size(); node += LowBit(node)) {
+				ys_[filled[node]++] = it->second;
+			}
+		}
+		size_t kept = 0;
+		for (size_t node = 1; node <= xs_.size(); ++node) {
+			const auto slice_begin = ys_.begin() + begins_[node];
+			const auto slice_end = ys_.begin() + begins_[node + 1];
+			std::sort(slice_begin, slice_end);
+			const auto unique_end = std::unique(slice_begin, slice_end);
+			begins_[node] = kept;
+			kept = std::copy(slice_begin, unique_end, ys_.begin() + kept) - ys_.begin();
+		}
+		begins_[xs_.size() + 1] = kept;
+		ys_.resize(kept);
+		ys_.shrink_to_fit();
+		tree_.assign(kept + 1, identity_);
+	}
+
+	template<class Container>
+	explicit CompressedGridFenwickTree(const Container& points)
+		: CompressedGridFenwickTree(std::begin(points), std::end(points)) {}
+
+	void AddAt(const Coordinate& x, const Coordinate& y, const Data& data) {
+		for (size_t node = XIndex(x) + 1; node <= xs_.size(); node += LowBit(node)) {
+			const Coordinate* slice = ys_.data() + begins_[node];
+			const size_t count = begins_[node + 1] - begins_[node];
+			const size_t position = std::lower_bound(slice, slice + count, y) - slice;
+			assert(position < count && slice[position] == y);
+			Data* inner = tree_.data() + begins_[node];
+			for (size_t i = position + 1; i <= count; i += LowBit(i)) {
+				inner[i] = this->operation()(inner[i], data);
+			}
+		}
+	}
+
+	void SetAt(const Coordinate& x, const Coordinate& y, const Data& data) {
+		AddAt(x, y, inverse_(data, At(x, y)));
+	}
+
+	Data At(const Coordinate& x, const Coordinate& y) const {
+		return RangeReduce(x, y, x, y);
+	}
+
+	// Points with x_low <= x <= x_high and y_low <= y <= y_high.
+	Data RangeReduce(
+		const Coordinate& x_low,
+		const Coordinate& y_low,
+		const Coordinate& x_high,
+		const Coordinate& y_high) const {
+		assert(!(x_high < x_low) && !(y_high < y_low));
+		const size_t x_begin = std::lower_bound(xs_.begin(), xs_.end(), x_low) - xs_.begin();
+		const size_t x_end = std::upper_bound(xs_.begin(), xs_.end(), x_high) - xs_.begin();
+		return inverse_(PrefixReduce(x_end, y_low, y_high), PrefixReduce(x_begin, y_low, y_high));
+	}
+
+	// Distinct x and y pairs stored over all inner trees, about p log p.
+	size_t node_count() const { return ys_.size(); }
+
+private:
+	static size_t LowBit(size_t i) { return i & (~i + 1); }
+
+	size_t XIndex(const Coordinate& x) const {
+		const size_t index = std::lower_bound(xs_.begin(), xs_.end(), x) - xs_.begin();
+		assert(index < xs_.size() && xs_[index] == x);
+		return index;
+	}
+
+	// Reduction over the first x_count distinct x and y in [y_low, y_high].
+	Data PrefixReduce(size_t x_count, const Coordinate& y_low, const Coordinate& y_high) const {
+		Data result = identity_;
+		for (size_t node = x_count; node != 0; node -= LowBit(node)) {
+			const Coordinate* slice = ys_.data() + begins_[node];
+			const Coordinate* slice_end = ys_.data() + begins_[node + 1];
+			const size_t y_begin = std::lower_bound(slice, slice_end, y_low) - slice;
+			const size_t y_end = std::upper_bound(slice + y_begin, slice_end, y_high) - slice;
+			const Data* inner = tree_.data() + begins_[node];
+			result = this->operation()(result, inverse_(InnerPrefix(inner, y_end), InnerPrefix(inner, y_begin)));
+		}
+		return result;
+	}
+
+	// Reduction of the first count elements of the 1-based inner tree.
+	Data InnerPrefix(const Data* inner, size_t count) const {
+		Data result = identity_;
+		for (; count != 0; count -= LowBit(count)) {
+			result = this->operation()(result, inner[count]);
+		}
+		return result;
+	}
+
+	InverseOp inverse_;
+	Data identity_;
+	std::vector<Coordinate> xs_;
+	// Node i (1-based) owns [begins_[i], begins_[i + 1]) of ys_, and the
+	// element after each of those in tree_: tree_[0] is padding so that
+	// every inner tree is 1-based in place.
+	std::vector<size_t> begins_;
+	std::vector<Coordinate> ys_;
+	std::vector<Data> tree_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+// Actions for LazyIntervalTree.  An action describes a pending update of a
+// whole range:
+//   Lazy                    - the pending update itself
+//   Identity()              - the update that changes nothing
+//   Apply(f, x, length)     - the reduction of `length` elements that reduced
+//                             to x before f was applied to each of them
+//   Compose(newer, older)   - the single update equal to older, then newer
+// `scaled` tells whether the reduction grows with the number of elements
+// (sums) or not (minimum, maximum).
+
+// Adds a constant to every element of the range.
+template<class T, bool scaled>
+struct RangeAdd {
+	using Lazy = T;
+	static Lazy Identity() { return T(); }
+	static T Apply(const Lazy& f, const T& x, size_t length) {
+		return scaled ? x + f * static_cast<T>(length) : x + f;
+	}
+	static Lazy Compose(const Lazy& newer, const Lazy& older) { return newer + older; }
+};
+
+// Sets every element of the range to a constant.
+template<class T, bool scaled>
+struct RangeAssign {
+	struct Lazy {
+		bool set;
+		T value;
+	};
+	static Lazy Identity() { return Lazy{ false, T() }; }
+	static T Apply(const Lazy& f, const T& x, size_t length) {
+		if (!f.set) {
+			return x;
+		}
+		return scaled ? f.value * static_cast<T>(length) : f.value;
+	}
+	static Lazy Compose(const Lazy& newer, const Lazy& older) { return newer.set ? newer : older; }
+	static Lazy To(const T& value) { return Lazy{ true, value }; }
+};
+
+// Segment tree with range updates and range reductions, both O(log n).
+// Same layout as SimpleIntervalTree: leaves start at capacity_, a power of two,
+// and node k has children 2k and 2k+1.  Pending updates live in lazy_, one per
+// inner node, and are pushed down only along the borders of a range, so both
+// operations are iterative loops over O(log n) nodes.
+//
+// default_value must be the identity of Op (0 for sums, the maximum of the
+// type for minimums).
+template<class Data, class Op, class Action>
+class LazyIntervalTree : private impl::OperationHolder<Op> {
+public:
+	using Lazy = typename Action::Lazy;
+
+	LazyIntervalTree(size_t size, const Data& default_value, Op op = Op())
+		: impl::OperationHolder<Op>(std::move(op))
+		, size_(size)
+		, identity_(default_value) {
+		assert(size > 0);
+		capacity_ = impl::CeilPowerOfTwo(size);
+		log_ = 0;
+		while ((size_t(1) << log_) < capacity_) {
+			++log_;
+		}
+		tree_.assign(capacity_ * 2, default_value);
+		lazy_.assign(capacity_, Action::Identity());
+	}
+
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		assert(static_cast<size_t>(std::distance(begin, end)) <= size_);
+		Iter it = begin;
+		for (size_t offset = capacity_; it != end; ++it, ++offset) {
+			tree_[offset] = *it;
+		}
+		std::fill(lazy_.begin(), lazy_.end(), Action::Identity());
+		for (size_t offset = capacity_ - 1; offset != 0; --offset) {
+			Recompute(offset);
+		}
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	Data At(size_t offset) {
+		assert(offset < size_);
+		offset += capacity_;
+		PushPath(offset);
+		return tree_[offset];
+	}
+
+	void SetAt(size_t offset, const Data& data) {
+		assert(offset < size_);
+		offset += capacity_;
+		PushPath(offset);
+		tree_[offset] = data;
+		for (size_t height = 1; height <= log_; ++height) {
+			Recompute(offset >> height);
+		}
+	}
+
+	// left and right - inclusive
+	void RangeUpdate(size_t left, size_t right, const Lazy& action) {
+		assert(right < size_);
+		assert(left <= right);
+		const size_t begin = left + capacity_;
+		const size_t end = right + 1 + capacity_;
+		PushBorders(begin, end);
+
+		size_t l = begin;
+		size_t r = end;
+		for (size_t height = 0; l < r; ++height, l /= 2, r /= 2) {
+			if (l % 2 == 1) {
+				ApplyTo(l++, action, height);
+			}
+			if (r % 2 == 1) {
+				ApplyTo(--r, action, height);
+			}
+		}
+
+		for (size_t height = 1; height <= log_; ++height) {
+			if (((begin >> height) << height) != begin) {
+				Recompute(begin >> height);
+			}
+			if (((end >> height) << height) != end) {
+				Recompute((end - 1) >> height);
+			}
+		}
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(size_t left, size_t right) {
+		assert(right < size_);
+		assert(left <= right);
+		size_t l = left + capacity_;
+		size_t r = right + 1 + capacity_;
+		PushBorders(l, r);
+
+		Data left_slope = identity_;
+		Data right_slope = identity_;
+		for (; l < r; l /= 2, r /= 2) {
+			if (l % 2 == 1) {
+				ApplyOp(left_slope, tree_[l++], &left_slope);
+			}
+			if (r % 2 == 1) {
+				ApplyOp(tree_[--r], right_slope, &right_slope);
+			}
+		}
+		ApplyOp(left_slope, right_slope, &left_slope);
+		return left_slope;
+	}
+
+	// The first offset right >= left at which pred(RangeReduce(left, right))
+	// turns false, or size() if it never does; pred must be monotone and hold
+	// for the identity.  O(log n), pushing pending updates on the way down.
+	template<class Predicate>
+	size_t MaxRight(size_t left, Predicate pred) {
+		assert(left <= size_);
+		assert(pred(identity_));
+		if (left == size_) {
+			return size_;
+		}
+		size_t offset = left + capacity_;
+		for (size_t height = log_; height >= 1; --height) {
+			Push(offset >> height, height);
+		}
+		Data slope = identity_;
+		size_t height = 0;
+		do {
+			while (offset % 2 == 0) {
+				offset /= 2;
+				++height;
+			}
+			Data candidate;
+			ApplyOp(slope, tree_[offset], &candidate);
+			if (!pred(candidate)) {
+				while (offset < capacity_) {
+					Push(offset, height);
+					offset *= 2;
+					--height;
+					ApplyOp(slope, tree_[offset], &candidate);
+					if (pred(candidate)) {
+						slope = std::move(candidate);
+						++offset;
+					}
+				}
+				return std::min(offset - capacity_, size_);
+			}
+			slope = std::move(candidate);
+			++offset;
+		} while ((offset & (offset - 1)) != 0);
+		return size_;
+	}
+
+	// The mirror of MaxRight: the smallest left <= right + 1 such that
+	// pred(RangeReduce(l, right)) holds for every l in [left, right].
+	template<class Predicate>
+	size_t MinLeft(size_t right, Predicate pred) {
+		assert(right < size_);
+		assert(pred(identity_));
+		size_t offset = right + 1 + capacity_;
+		for (size_t height = log_; height >= 1; --height) {
+			Push((offset - 1) >> height, height);
+		}
+		Data slope = identity_;
+		size_t height = 0;
+		do {
+			--offset;
+			while (offset > 1 && offset % 2 == 1) {
+				offset /= 2;
+				++height;
+			}
+			Data candidate;
+			ApplyOp(tree_[offset], slope, &candidate);
+			if (!pred(candidate)) {
+				while (offset < capacity_) {
+					Push(offset, height);
+					offset = offset * 2 + 1;
+					--height;
+					ApplyOp(tree_[offset], slope, &candidate);
+					if (pred(candidate)) {
+						slope = std::move(candidate);
+						--offset;
+					}
+				}
+				return offset + 1 - capacity_;
+			}
+			slope = std::move(candidate);
+		} while ((offset & (offset - 1)) != 0);
+		return 0;
+	}
+
+	size_t size() const { return size_; }
+
+private:
+	void ApplyOp(const Data& left, const Data& right, Data* output) const {
+		*output = this->operation()(left, right);
+	}
+
+	void Recompute(size_t offset) {
+		ApplyOp(tree_[offset * 2], tree_[offset * 2 + 1], &tree_[offset]);
+	}
+
+	// Applies action to node offset, which covers 2^height leaves.
+	void ApplyTo(size_t offset, const Lazy& action, size_t height) {
+		tree_[offset] = Action::Apply(action, tree_[offset], size_t(1) << height);
+		if (offset < capacity_) {
+			lazy_[offset] = Action::Compose(action, lazy_[offset]);
+		}
+	}
+
+	void Push(size_t offset, size_t height) {
+		ApplyTo(offset * 2, lazy_[offset], height - 1);
+		ApplyTo(offset * 2 + 1, lazy_[offset], height - 1);
+		lazy_[offset] = Action::Identity();
+	}
+
+	// Pushes pending updates into the leaf at offset from all its ancestors.
+	void PushPath(size_t offset) {
+		for (size_t height = log_; height >= 1; --height) {
+			Push(offset >> height, height);
+		}
+	}
+
+	// Pushes pending updates out of every node that covers [begin, end) only
+	// partially, so the nodes inside can be read or updated directly.
+	void PushBorders(size_t begin, size_t end) {
+		for (size_t height = log_; height >= 1; --height) {
+			if (((begin >> height) << height) != begin) {
+				Push(begin >> height, height);
+			}
+			if (((end >> height) << height) != end) {
+				Push((end - 1) >> height, height);
+			}
+		}
+	}
+
+	size_t capacity_;
+	size_t log_;
+	size_t size_;
+	Data identity_;
+	std::vector<Data> tree_;
+	std::vector<Lazy> lazy_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+namespace impl {
+
+// A whole file mapped read-only; throws std::runtime_error if it cannot be.
+class ReadOnlyFileMapping {
+public:
+	explicit ReadOnlyFileMapping(const std::string& path) : data_(nullptr), size_(0) {
+#ifdef _WIN32
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Cannot open " + path);
+		}
+		LARGE_INTEGER size;
+		mapping_ = nullptr;
+		if (GetFileSizeEx(file_, &size) && size.QuadPart > 0) {
+			mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		}
+		if (mapping_ != nullptr) {
+			data_ = MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+		}
+		if (data_ == nullptr) {
+			Close();
+			throw std::runtime_error("Cannot map " + path);
+		}
+		size_ = static_cast<size_t>(size.QuadPart);
+#else
+		const int file = open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			throw std::runtime_error("Cannot open " + path);
+		}
+		struct stat status;
+		void* data = MAP_FAILED;
+		if (fstat(file, &status) == 0 && status.st_size > 0) {
+			data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+		}
+		// The mapping keeps the file alive on its own.
+		close(file);
+		if (data == MAP_FAILED) {
+			throw std::runtime_error("Cannot map " + path);
+		}
+		data_ = data;
+		size_ = static_cast<size_t>(status.st_size);
+#endif
+	}
+
+	ReadOnlyFileMapping(const ReadOnlyFileMapping&) = delete;
+	ReadOnlyFileMapping& operator=(const ReadOnlyFileMapping&) = delete;
+
+	~ReadOnlyFileMapping() { Close(); }
+
+	const void* data() const { return data_; }
+	size_t size() const { return size_; }
+
+private:
+	void Close() {
+#ifdef _WIN32
+		if (data_ != nullptr) {
+			UnmapViewOfFile(data_);
+		}
+		if (mapping_ != nullptr) {
+			CloseHandle(mapping_);
+		}
+		CloseHandle(file_);
+#else
+		if (data_ != nullptr) {
+			munmap(data_, size_);
+		}
+#endif
+	}
+
+	void* data_;
+	size_t size_;
+#ifdef _WIN32
+	HANDLE file_;
+	HANDLE mapping_;
+#endif
+};
+
+}  // namespace impl
+
+// Read-only queries straight over a file written by BasicIntervalTree::Save.
+// Opening maps the file and checks its header, nothing more; the nodes are
+// paged in by the queries that touch them, so a large tree is usable at once
+// and shares the page cache between processes that map the same file.
+//
+// Op must be the one the tree was saved with.  Each process sees the file as
+// it was when mapped only as long as nobody rewrites it in place: write a new
+// snapshot next to it and rename it over instead.
+template<class Data, class Op>
+class MappedIntervalTree : private impl::OperationHolder<Op> {
+public:
+	static_assert(std::is_trivially_copyable<Data>::value, "nodes are read as raw bytes");
+	static_assert(alignof(Data) <= sizeof(impl::SnapshotHeader), "nodes follow the header unpadded");
+
+	using Operation = Op;
+
+	// Throws std::runtime_error if the file cannot be mapped and
+	// std::invalid_argument if it is not a snapshot of Data.
+	explicit MappedIntervalTree(const std::string& path, Op op = Op())
+		: impl::OperationHolder<Op>(std::move(op))
+		, file_(path) {
+		impl::SnapshotHeader header;
+		if (file_.size() < sizeof(header)) {
+			throw std::invalid_argument("Truncated interval tree snapshot.");
+		}
+		std::memcpy(&header, file_.data(), sizeof(header));
+		header.Check(sizeof(Data));
+		size_ = static_cast<size_t>(header.size);
+		capacity_ = static_cast<size_t>(header.capacity);
+		if (file_.size() - sizeof(header) < capacity_ * 2 * sizeof(Data)) {
+			throw std::invalid_argument("Truncated interval tree snapshot.");
+		}
+		tree_ = reinterpret_cast<const Data*>(static_cast<const char*>(file_.data()) + sizeof(header));
+	}
+
+	Data At(size_t offset) const {
+		assert(offset < size_);
+		return tree_[offset + capacity_];
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(size_t left, size_t right) const {
+		assert(right < size_);
+		assert(left <= right);
+		return impl::RangeReduceNodes(tree_, capacity_, left, right, this->operation());
+	}
+
+	size_t size() const { return size_; }
+
+private:
+	impl::ReadOnlyFileMapping file_;
+	size_t size_;
+	size_t capacity_;
+	const Data* tree_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
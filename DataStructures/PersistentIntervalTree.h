@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+// Segment tree that keeps every version.  An update copies only the
+// root-to-leaf path it changes, O(log n) new nodes, and shares the rest with
+// the version it started from, so any number of versions can be kept and
+// queried.  Versions are plain handles to a root and cost nothing to copy.
+//
+// All nodes of all versions live in one arena with 32-bit child indices;
+// creating more than 2^32 - 1 nodes throws std::length_error.
+// The nodes an update creates are consecutive, root first, so the new path
+// is read front to back; Build lays a whole array out in depth-first order
+// for the same reason.
+template<class Data, class Op>
+class PersistentIntervalTree : private impl::OperationHolder<Op> {
+public:
+	using Operation = Op;
+
+	struct Version {
+		std::uint32_t root;
+	};
+
+	// Also builds the initial version, every element default_value, from
+	// O(log n) nodes: subtrees of the same length are identical and shared.
+	PersistentIntervalTree(size_t size, const Data& default_value, Op op = Op())
+		: impl::OperationHolder<Op>(std::move(op))
+		, size_(size) {
+		assert(size > 0);
+		depth_ = 0;
+		while ((size_t(1) << depth_) < size) {
+			++depth_;
+		}
+		std::vector<std::pair<size_t, Index>> by_length;
+		initial_ = Version{ BuildUniform(size, default_value, &by_length) };
+	}
+
+	Version Initial() const { return initial_; }
+
+	// A new version holding [begin, end), exactly size() elements, in O(n).
+	template<class Iter>
+	Version Build(Iter begin, Iter end) {
+		assert(static_cast<size_t>(std::distance(begin, end)) == size_);
+		Grow(2 * size_);
+		return Version{ BuildFrom(begin, 0, size_) };
+	}
+
+	template<class Container>
+	Version Build(const Container& cont) {
+		return Build(std::begin(cont), std::end(cont));
+	}
+
+	Version SetAt(Version version, size_t offset, const Data& data) {
+		return Update(version, offset, [&data](const Data&) { return data; });
+	}
+
+	// add_front as in BasicIntervalTree::AddAt, for non-commutative Op.
+	Version AddAt(Version version, size_t offset, const Data& data, bool add_front = false) {
+		return Update(version, offset, [this, &data, add_front](const Data& old) {
+			return add_front ? this->operation()(data, old) : this->operation()(old, data);
+		});
+	}
+
+	// Applies the (offset, data) pairs of [begin, end) one after another,
+	// starting from base, and returns every intermediate version: result[i]
+	// holds the first i + 1 updates.  The arena grows once for the whole
+	// batch, so the paths of consecutive versions end up next to each other.
+	template<class UpdateIter>
+	std::vector<Version> SetAll(Version base, UpdateIter begin, UpdateIter end) {
+		const size_t count = static_cast<size_t>(std::distance(begin, end));
+		Grow(count * (depth_ + 1));
+		std::vector<Version> versions;
+		versions.reserve(count);
+		for (UpdateIter it = begin; it != end; ++it) {
+			base = SetAt(base, it->first, it->second);
+			versions.push_back(base);
+		}
+		return versions;
+	}
+
+	Data At(Version version, size_t offset) const {
+		return RangeReduce(version, offset, offset);
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(Version version, size_t left, size_t right) const {
+		assert(left <= right);
+		assert(right < size_);
+		return Reduce(version.root, 0, size_, left, right + 1);
+	}
+
+	// For counting trees (numeric Data, Op a sum) where newer was reached
+	// from older by adding counts: the offset that holds the k-th (0-based)
+	// unit of newer minus older.  With one version per prefix of an array
+	// and counts over its sorted values, KthInDifference(prefix[l],
+	// prefix[r + 1], k) is the rank of the k-th smallest value of [l, r].
+	size_t KthInDifference(Version older, Version newer, Data k) const {
+		assert(!(k < Data()));
+		assert(k < nodes_[newer.root].value - nodes_[older.root].value);
+		Index from = older.root;
+		Index to = newer.root;
+		size_t low = 0;
+		size_t high = size_;
+		while (high - low > 1) {
+			const size_t middle = low + (high - low) / 2;
+			const Data left = nodes_[nodes_[to].child[0]].value - nodes_[nodes_[from].child[0]].value;
+			if (k < left) {
+				from = nodes_[from].child[0];
+				to = nodes_[to].child[0];
+				high = middle;
+			}
+			else {
+				k = k - left;
+				from = nodes_[from].child[1];
+				to = nodes_[to].child[1];
+				low = middle;
+			}
+		}
+		return low;
+	}
+
+	// Nodes in the arena over all versions; each takes sizeof(Data) + 8 bytes.
+	size_t node_count() const { return nodes_.size(); }
+
+	void Reserve(size_t count) { nodes_.reserve(count); }
+
+	size_t size() const { return size_; }
+
+private:
+	using Index = std::uint32_t;
+
+	struct Node {
+		Data value;
+		Index child[2];
+	};
+
+	// Room for count more nodes, growing geometrically so that many small
+	// batches still reallocate the arena only a few times.
+	void Grow(size_t count) {
+		const size_t needed = nodes_.size() + count;
+		if (needed > nodes_.capacity()) {
+			nodes_.reserve(std::max(needed, nodes_.capacity() * 2));
+		}
+	}
+
+	// Throws std::length_error once the 32-bit node indices run out; the
+	// versions made so far stay valid.
+	Index NewNode(const Node& node) {
+		if (nodes_.size() >= std::numeric_limits<Index>::max()) {
+			throw std::length_error("PersistentIntervalTree has more nodes than 32-bit indices address.");
+		}
+		nodes_.push_back(node);
+		return static_cast<Index>(nodes_.size() - 1);
+	}
+
+	Index BuildUniform(size_t length, const Data& value, std::vector<std::pair<size_t, Index>>* by_length) {
+		for (const auto& built : *by_length) {
+			if (built.first == length) {
+				return built.second;
+			}
+		}
+		Index node;
+		if (length == 1) {
+			node = NewNode(Node{ value, { 0, 0 } });
+		}
+		else {
+			const Index left = BuildUniform(length / 2, value, by_length);
+			const Index right = BuildUniform(length - length / 2, value, by_length);
+			node = NewNode(Node{ this->operation()(nodes_[left].value, nodes_[right].value), { left, right } });
+		}
+		by_length->emplace_back(length, node);
+		return node;
+	}
+
+	// Builds the subtree over [low, high), the node before its children,
+	// from the next high - low elements of it.  Leaves are reached left to
+	// right, so it only ever steps forward.
+	template<class Iter>
+	Index BuildFrom(Iter& it, size_t low, size_t high) {
+		if (high - low == 1) {
+			return NewNode(Node{ *it++, { 0, 0 } });
+		}
+		const Index node = NewNode(Node{ Data(), { 0, 0 } });
+		const size_t middle = low + (high - low) / 2;
+		const Index left = BuildFrom(it, low, middle);
+		const Index right = BuildFrom(it, middle, high);
+		nodes_[node].child[0] = left;
+		nodes_[node].child[1] = right;
+		nodes_[node].value = this->operation()(nodes_[left].value, nodes_[right].value);
+		return node;
+	}
+
+	// Copies the path to offset, root first, with the leaf set to
+	// update(its old value), and recomputes the copies bottom-up.
+	template<class Updater>
+	Version Update(Version version, size_t offset, const Updater& update) {
+		assert(offset < size_);
+		const Index root = static_cast<Index>(nodes_.size());
+		Index old = version.root;
+		size_t low = 0;
+		size_t high = size_;
+		while (high - low > 1) {
+			const Index copy = NewNode(nodes_[old]);
+			const size_t middle = low + (high - low) / 2;
+			const int side = offset >= middle ? 1 : 0;
+			if (side == 1) {
+				low = middle;
+			}
+			else {
+				high = middle;
+			}
+			old = nodes_[copy].child[side];
+			// The next copy is the next node.
+			nodes_[copy].child[side] = copy + 1;
+		}
+		NewNode(Node{ update(nodes_[old].value), { 0, 0 } });
+		for (Index node = static_cast<Index>(nodes_.size() - 1); node != root;) {
+			--node;
+			nodes_[node].value = this->operation()(
+				nodes_[nodes_[node].child[0]].value, nodes_[nodes_[node].child[1]].value);
+		}
+		return Version{ root };
+	}
+
+	// Reduction of [left, right) within node, which covers [low, high).
+	Data Reduce(Index node, size_t low, size_t high, size_t left, size_t right) const {
+		if (left <= low && high <= right) {
+			return nodes_[node].value;
+		}
+		const size_t middle = low + (high - low) / 2;
+		if (right <= middle) {
+			return Reduce(nodes_[node].child[0], low, middle, left, right);
+		}
+		if (left >= middle) {
+			return Reduce(nodes_[node].child[1], middle, high, left, right);
+		}
+		return this->operation()(
+			Reduce(nodes_[node].child[0], low, middle, left, right),
+			Reduce(nodes_[node].child[1], middle, high, left, right));
+	}
+
+	size_t size_;
+	size_t depth_;
+	Version initial_;
+	std::vector<Node> nodes_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
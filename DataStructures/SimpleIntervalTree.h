@@ -1,32 +1,212 @@
 #pragma once
 
+#include <algorithm>
 #include <utility>
 #include <functional>
 #include <iterator>
 #include <cassert>
+#include <cstdint>
+#include <istream>
 #include <numeric>
+#include <ostream>
+#include <stdexcept>
 #include <vector>
 #include <limits>
+#include <thread>
+#include <type_traits>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "../NumberTheory/BitOperations.h"
 
 namespace data_structures {
 namespace interval_trees {
 
+// Stateless reduction functors for BasicIntervalTree.
+template<class T>
+struct MinOp {
+	T operator()(const T& left, const T& right) const { return std::min(left, right); }
+};
+
+template<class T>
+struct MaxOp {
+	T operator()(const T& left, const T& right) const { return std::max(left, right); }
+};
+
+template<class T>
+struct SumOp {
+	T operator()(const T& left, const T& right) const { return left + right; }
+};
+
+// The inverse of SumOp: SumOp()(DifferenceOp()(a, b), b) == a.
+template<class T>
+struct DifferenceOp {
+	T operator()(const T& left, const T& right) const { return left - right; }
+};
+
+// Where the leaves go.
+//   PowerOfTwo - leaves start at the next power of two, so every node covers
+//                an aligned range; up to 4n nodes.
+//   Compact    - leaves start at n, 2n nodes in total.  Nodes near the top may
+//                cover ranges that wrap around, which the bottom-up loops of
+//                BasicIntervalTree do not mind.
+enum class TreeLayout { PowerOfTwo, Compact };
+
+namespace impl {
+
+using number_theory::bit_operations::CountTrailingZeros;
+using number_theory::bit_operations::PopCount;
+
+// Index of the highest set bit; value must not be zero.
+inline size_t FloorLog2(size_t value) {
+	assert(value != 0);
+	return number_theory::bit_operations::BitLength(value) - 1;
+}
+
+// The smallest power of two that is >= value.
+inline size_t CeilPowerOfTwo(size_t value) {
+	return value <= 1 ? 1 : size_t(1) << (FloorLog2(value - 1) + 1);
+}
+
+// Runs body(chunk_begin, chunk_end) over [begin, end) split into equal chunks,
+// one per thread, the calling thread included.
+template<class Body>
+void ParallelChunks(size_t begin, size_t end, unsigned threads, const Body& body) {
+	const size_t count = end - begin;
+	if (threads <= 1 || count < 2) {
+		body(begin, end);
+		return;
+	}
+	if (threads > count) {
+		threads = static_cast<unsigned>(count);
+	}
+	std::vector<std::thread> workers;
+	workers.reserve(threads - 1);
+	for (unsigned i = 1; i < threads; ++i) {
+		workers.emplace_back(body, begin + count * i / threads, begin + count * (i + 1) / threads);
+	}
+	body(begin, begin + count / threads);
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+// Asks for the cache line holding address to be loaded.
+inline void Prefetch(const void* address) {
+#ifdef _MSC_VER
+	_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+	__builtin_prefetch(address);
+#endif
+}
+
+// Keeps the operation as an empty base when it has no state, so a functor
+// like MinOp takes no space in the tree (what [[no_unique_address]] does in
+// C++20).
+template<class Op, bool as_base = std::is_empty<Op>::value && !std::is_final<Op>::value>
+class OperationHolder : private Op {
+public:
+	explicit OperationHolder(Op op) : Op(std::move(op)) {}
+	const Op& operation() const { return *this; }
+};
+
+template<class Op>
+class OperationHolder<Op, false> {
+public:
+	explicit OperationHolder(Op op) : op_(std::move(op)) {}
+	const Op& operation() const { return op_; }
+private:
+	Op op_;
+};
+
+// RangeReduce over the 2 * capacity nodes of a bottom-up tree at tree.
+// left and right - inclusive
+template<class Data, class Op>
+Data RangeReduceNodes(const Data* tree, size_t capacity, size_t left, size_t right, const Op& op) {
+	left += capacity;
+	right += capacity;
+	if (left == right) {
+		return tree[left];
+	}
+	// The end leaves seed the slopes, so Op needs no identity; the rest is
+	// the half-open bottom-up walk over [left, right), which is correct for
+	// either layout and keeps the order of the operands.
+	Data left_slope = tree[left++];
+	Data right_slope = tree[right];
+	for (; left < right; left /= 2, right /= 2) {
+		if (left % 2 == 1) {
+			left_slope = op(left_slope, tree[left++]);
+		}
+		if (right % 2 == 1) {
+			right_slope = op(tree[--right], right_slope);
+		}
+	}
+	return op(left_slope, right_slope);
+}
+
+// What BasicIntervalTree::Save writes before the 2 * capacity nodes, node 0
+// included.  The nodes are raw bytes, so a snapshot is only readable on the
+// same kind of machine and with the same Data.
+struct SnapshotHeader {
+	static const std::uint64_t kMagic = 0x3145455254544e49ULL;  // "INTTREE1"
+
+	std::uint64_t magic;
+	std::uint64_t data_size;
+	std::uint64_t size;
+	std::uint64_t capacity;
+
+	// Throws std::invalid_argument unless this can head a snapshot of
+	// 2 * capacity nodes of data_size bytes each.
+	void Check(size_t expected_data_size) const {
+		if (magic != kMagic) {
+			throw std::invalid_argument("Not an interval tree snapshot.");
+		}
+		if (data_size != expected_data_size) {
+			throw std::invalid_argument("Interval tree snapshot of another Data.");
+		}
+		if (size == 0 || size > std::numeric_limits<size_t>::max() / 4 / data_size ||
+			(capacity != size && capacity != CeilPowerOfTwo(static_cast<size_t>(size)))) {
+			throw std::invalid_argument("Malformed interval tree snapshot.");
+		}
+	}
+};
+
+}  // namespace impl
+
 // Data should implement the following methods:
 //   1) Copy constructor / operator=
 //   2) Default constructor
-template<class Data, bool is_commutative = false>
-class SimpleIntervalTree {
+// Op is a functor Data(const Data&, const Data&) const.  It is called
+// directly, so a stateless one is inlined into every update and query.
+template<class Data, class Op, bool is_commutative = false>
+class BasicIntervalTree : private impl::OperationHolder<Op> {
 public:
-	using Operation = std::function<Data(const Data&, const Data&)>;
-	SimpleIntervalTree(size_t size, Operation op, const Data& default_value) {
-		op_ = op;
+	using Operation = Op;
+	BasicIntervalTree(
+		size_t size,
+		const Data& default_value,
+		Op op = Op(),
+		TreeLayout layout = TreeLayout::PowerOfTwo)
+		: impl::OperationHolder<Op>(std::move(op)) {
+		assert(size > 0);
 		size_ = size;
-		capacity_ = size - 1;
-		for (int shift = 1; shift < sizeof(capacity_); shift *= 2) {
-			capacity_ |= capacity_ >> shift;
+		capacity_ = layout == TreeLayout::PowerOfTwo ? impl::CeilPowerOfTwo(size) : size;
+		tree_.resize(capacity_ * 2);
+		std::fill(tree_.begin() + capacity_, tree_.end(), default_value);
+		if (layout == TreeLayout::PowerOfTwo) {
+			// Every level holds copies of one value, so reduce once per level.
+			for (size_t level = capacity_ / 2; level != 0; level /= 2) {
+				ApplyOp(tree_[level * 2], tree_[level * 2], &tree_[level]);
+				std::fill(tree_.begin() + level + 1, tree_.begin() + level * 2, tree_[level]);
+			}
+		}
+		else {
+			for (size_t offset = capacity_ - 1; offset != 0; --offset) {
+				Recompute(offset);
+			}
 		}
-		capacity_ += 1;
-		tree_.assign(capacity_ * 2, default_value);
 	}
 
 	template<class Iter>
@@ -51,6 +231,47 @@ public:
 		FillFrom(std::begin(initializer_list), std::end(initializer_list));
 	}
 
+	// Same as FillFrom, for random access iterators, with the leaves and then
+	// each level large enough to be worth it split between threads.  Op must
+	// not throw.
+	template<class RandomIter>
+	void ParallelFillFrom(
+		RandomIter begin,
+		RandomIter end,
+		unsigned threads = std::thread::hardware_concurrency()) {
+		const size_t count = static_cast<size_t>(end - begin);
+		assert(count <= size_);
+		const size_t kMinChunk = size_t(1) << 15;
+		const auto threads_for = [threads, kMinChunk](size_t nodes) {
+			return static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), nodes / kMinChunk + 1));
+		};
+
+		impl::ParallelChunks(0, count, threads_for(count), [this, begin](size_t from, size_t to) {
+			std::copy(begin + from, begin + to, tree_.begin() + capacity_ + from);
+		});
+
+		// Nodes [level, 2 * level) only depend on nodes from 2 * level on.
+		size_t level = impl::CeilPowerOfTwo(capacity_) / 2;
+		for (; level != 0; level /= 2) {
+			const size_t level_end = std::min(level * 2, capacity_);
+			if (level >= level_end) {
+				continue;
+			}
+			impl::ParallelChunks(level, level_end, threads_for(level_end - level), [this](size_t from, size_t to) {
+				for (size_t offset = from; offset != to; ++offset) {
+					Recompute(offset);
+				}
+			});
+		}
+	}
+
+	template<class Container>
+	void ParallelFillFrom(
+		const Container& cont,
+		unsigned threads = std::thread::hardware_concurrency()) {
+		ParallelFillFrom(std::begin(cont), std::end(cont), threads);
+	}
+
 	void SetAt(size_t offset, const Data& data) {
 		assert(offset < size_);
 		offset += capacity_;
@@ -61,6 +282,60 @@ public:
 		}
 	}
 
+	// Same as calling SetAt for every (offset, data) pair of [begin, end) in
+	// order.  By default the leaves of a few updates ahead are prefetched while
+	// the current one walks up.  With merge_ancestors the leaves are written
+	// first (a later update of the same leaf wins) and every touched ancestor is
+	// then recomputed once, level by level, which pays off for large or
+	// clustered batches.
+	template<class UpdateIter>
+	void BatchSetAt(UpdateIter begin, UpdateIter end, bool merge_ancestors = false) {
+		if (!merge_ancestors) {
+			UpdateIter ahead = begin;
+			for (size_t i = 0; i < kPrefetchDistance && ahead != end; ++i, ++ahead) {
+				PrefetchPath(ahead->first + capacity_);
+			}
+			for (UpdateIter it = begin; it != end; ++it) {
+				if (ahead != end) {
+					PrefetchPath(ahead->first + capacity_);
+					++ahead;
+				}
+				SetAt(it->first, it->second);
+			}
+			return;
+		}
+
+		std::vector<size_t> nodes;
+		for (UpdateIter it = begin; it != end; ++it) {
+			assert(it->first < size_);
+			nodes.push_back(it->first + capacity_);
+			tree_[nodes.back()] = it->second;
+		}
+		std::sort(nodes.begin(), nodes.end());
+		nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+		// Halving keeps the offsets sorted, so each level only needs unique.
+		// Children always sit at higher offsets than their parents, so a node
+		// seen again one level up (possible in the compact layout) is simply
+		// recomputed once more after its deeper child.
+		while (!nodes.empty()) {
+			for (size_t& node : nodes) {
+				node /= 2;
+			}
+			nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+			if (nodes.front() == 0) {
+				nodes.erase(nodes.begin());
+			}
+			for (size_t node : nodes) {
+				Recompute(node);
+			}
+		}
+	}
+
+	template<class Container>
+	void BatchSetAt(const Container& updates, bool merge_ancestors = false) {
+		BatchSetAt(std::begin(updates), std::end(updates), merge_ancestors);
+	}
+
 	void AddAt(size_t offset, const Data& data, bool add_front=false) {
 		assert(offset < size_);
 		offset += capacity_;
@@ -90,31 +365,170 @@ public:
 	Data RangeReduce(size_t left, size_t right) {
 		assert(right < size_);
 		assert(left <= right);
-		left += capacity_;
-		right += capacity_;
-		if (left == right) {
-			return tree_[left];
+		return impl::RangeReduceNodes(tree_.data(), capacity_, left, right, this->operation());
+	}
+
+	// The first offset right >= left at which pred(RangeReduce(left, right))
+	// turns false, or size() if it never does; pred must be monotone (true,
+	// then false as the range grows).  One climb from the left leaf and one
+	// descent, O(log n) calls of Op and pred, instead of a binary search over
+	// RangeReduce.  Needs the PowerOfTwo layout; the leaves past size() hold
+	// default_value, which should be the identity of Op.
+	template<class Predicate>
+	size_t MaxRight(size_t left, Predicate pred) {
+		assert(left <= size_);
+		assert((capacity_ & (capacity_ - 1)) == 0);
+		if (left == size_) {
+			return size_;
 		}
-		Data left_slope = tree_[left];
-		Data right_slope = tree_[right];
-		while (right - left != 1) {
-			if (left % 2 == 0) {
-				ApplyOp(left_slope, tree_[left + 1], &left_slope);
+		Data slope = Data();
+		bool has_slope = false;
+		// The reduction of the range so far followed by node offset.
+		const auto extend = [this, &slope, &has_slope](size_t offset) {
+			return has_slope ? this->operation()(slope, tree_[offset]) : tree_[offset];
+		};
+		size_t offset = left + capacity_;
+		do {
+			while (offset % 2 == 0) {
+				offset /= 2;
 			}
-			if (right % 2 == 1) {
-				ApplyOp(tree_[right - 1], right_slope, &right_slope);
+			Data candidate = extend(offset);
+			if (!pred(candidate)) {
+				while (offset < capacity_) {
+					offset *= 2;
+					candidate = extend(offset);
+					if (pred(candidate)) {
+						slope = std::move(candidate);
+						has_slope = true;
+						++offset;
+					}
+				}
+				return std::min(offset - capacity_, size_);
+			}
+			slope = std::move(candidate);
+			has_slope = true;
+			++offset;
+		} while ((offset & (offset - 1)) != 0);
+		return size_;
+	}
+
+	// The mirror of MaxRight: the smallest left <= right + 1 such that
+	// pred(RangeReduce(l, right)) holds for every l in [left, right], that
+	// is one past the last offset at which it turns false, or 0.
+	template<class Predicate>
+	size_t MinLeft(size_t right, Predicate pred) {
+		assert(right < size_);
+		assert((capacity_ & (capacity_ - 1)) == 0);
+		Data slope = Data();
+		bool has_slope = false;
+		const auto extend = [this, &slope, &has_slope](size_t offset) {
+			return has_slope ? this->operation()(tree_[offset], slope) : tree_[offset];
+		};
+		size_t offset = right + 1 + capacity_;
+		do {
+			--offset;
+			while (offset > 1 && offset % 2 == 1) {
+				offset /= 2;
 			}
-			left /= 2;
-			right /= 2;
+			Data candidate = extend(offset);
+			if (!pred(candidate)) {
+				while (offset < capacity_) {
+					offset = offset * 2 + 1;
+					candidate = extend(offset);
+					if (pred(candidate)) {
+						slope = std::move(candidate);
+						has_slope = true;
+						--offset;
+					}
+				}
+				return offset + 1 - capacity_;
+			}
+			slope = std::move(candidate);
+			has_slope = true;
+		} while ((offset & (offset - 1)) != 0);
+		return 0;
+	}
+
+	// Writes RangeReduce(left, right) to out for every (left, right) pair of
+	// [begin, end) and returns the end of the output.  The border nodes of a
+	// query a few places ahead are prefetched while the current one is
+	// reduced, so the cache misses of neighbouring queries overlap instead of
+	// being paid one after another.
+	template<class QueryIter, class OutIter>
+	OutIter BatchRangeReduce(QueryIter begin, QueryIter end, OutIter out) {
+		QueryIter ahead = begin;
+		for (size_t i = 0; i < kPrefetchDistance && ahead != end; ++i, ++ahead) {
+			PrefetchBorders(ahead->first, ahead->second);
+		}
+		for (QueryIter it = begin; it != end; ++it, ++out) {
+			if (ahead != end) {
+				PrefetchBorders(ahead->first, ahead->second);
+				++ahead;
+			}
+			*out = RangeReduce(it->first, it->second);
+		}
+		return out;
+	}
+
+	template<class Container>
+	std::vector<Data> BatchRangeReduce(const Container& queries) {
+		std::vector<Data> results;
+		results.reserve(std::distance(std::begin(queries), std::end(queries)));
+		BatchRangeReduce(std::begin(queries), std::end(queries), std::back_inserter(results));
+		return results;
+	}
+
+	// Writes the tree as an impl::SnapshotHeader and the raw nodes, for Load
+	// or MappedIntervalTree to pick up without recomputing anything.
+	void Save(std::ostream& out) const {
+		static_assert(std::is_trivially_copyable<Data>::value, "nodes are saved as raw bytes");
+		impl::SnapshotHeader header{ impl::SnapshotHeader::kMagic, sizeof(Data), size_, capacity_ };
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(tree_.data()), tree_.size() * sizeof(Data));
+	}
+
+	// Replaces the tree, size and layout included, with one written by Save.
+	// Throws std::invalid_argument for anything else or a truncated stream;
+	// the tree is unchanged then.
+	void Load(std::istream& in) {
+		static_assert(std::is_trivially_copyable<Data>::value, "nodes are loaded as raw bytes");
+		impl::SnapshotHeader header;
+		if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+			throw std::invalid_argument("Truncated interval tree snapshot.");
+		}
+		header.Check(sizeof(Data));
+		std::vector<Data> tree(static_cast<size_t>(header.capacity) * 2);
+		if (!in.read(reinterpret_cast<char*>(tree.data()), tree.size() * sizeof(Data))) {
+			throw std::invalid_argument("Truncated interval tree snapshot.");
 		}
-		ApplyOp(left_slope, right_slope, &left_slope);
-		return left_slope;
+		size_ = static_cast<size_t>(header.size);
+		capacity_ = static_cast<size_t>(header.capacity);
+		tree_.swap(tree);
 	}
 
+	size_t size() const { return size_; }
+
 private:
+	// How many queries or updates ahead BatchRangeReduce and BatchSetAt
+	// prefetch, and how many of the lowest levels; the levels above are few
+	// enough nodes to stay in cache anyway.
+	static const size_t kPrefetchDistance = 8;
+	static const size_t kPrefetchLevels = 4;
+
+	void PrefetchPath(size_t offset) const {
+		for (size_t level = 0; level < kPrefetchLevels && offset != 0; ++level, offset /= 2) {
+			impl::Prefetch(tree_.data() + offset);
+		}
+	}
+
+	void PrefetchBorders(size_t left, size_t right) const {
+		PrefetchPath(left + capacity_);
+		PrefetchPath(right + capacity_);
+	}
+
 	// To make it more flexible.
 	void ApplyOp(const Data& left, const Data& right, Data* output) {
-		*output = op_(left, right);
+		*output = this->operation()(left, right);
 	}
 
 	void Recompute(size_t offset) {
@@ -123,18 +537,35 @@ private:
 
 	size_t capacity_;
 	size_t size_;
-	Operation op_;
 	std::vector<Data> tree_;
 };
 
+// The operation is chosen at run time, at the price of an indirect call per
+// visited node.
+template<class Data, bool is_commutative = false>
+class SimpleIntervalTree
+	: public BasicIntervalTree<Data, std::function<Data(const Data&, const Data&)>, is_commutative> {
+public:
+	using Operation = std::function<Data(const Data&, const Data&)>;
+	SimpleIntervalTree(
+		size_t size,
+		Operation op,
+		const Data& default_value,
+		TreeLayout layout = TreeLayout::PowerOfTwo)
+		: BasicIntervalTree<Data, Operation, is_commutative>(size, default_value, std::move(op), layout)
+	{}
+};
+
 template<class T>
-struct MinimumIntervalTree : public SimpleIntervalTree<T, true>
+struct MinimumIntervalTree : public BasicIntervalTree<T, MinOp<T>, true>
 {
-	using SimpleIntervalTree<T, true>::SimpleIntervalTree;
-	MinimumIntervalTree(size_t size) : SimpleIntervalTree<T, true>(
-		size,
-		[](const T& left, const T& right) {return std::min(left, right); },
-		std::numeric_limits<T>::max())
+	using BasicIntervalTree<T, MinOp<T>, true>::BasicIntervalTree;
+	MinimumIntervalTree(size_t size, TreeLayout layout = TreeLayout::PowerOfTwo)
+		: BasicIntervalTree<T, MinOp<T>, true>(
+			size,
+			std::numeric_limits<T>::max(),
+			MinOp<T>(),
+			layout)
 	{}
 };
 
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+// Segment tree over a coordinate range too large to allocate, like
+// [0, 2^40): nodes are created on the first update below them, so memory
+// grows with the number of distinct updated offsets (about log2(size) nodes
+// each) instead of with size.
+//
+// Nodes live in one vector and refer to their children by 32-bit index, so
+// there is no allocation per node and a node of a 64-bit Data is 16 bytes.
+// Index 0 is a sentinel holding the identity: a missing child reads as a
+// range of identities.  identity must therefore really be the identity of
+// Op; it is also what untouched offsets read as.
+template<class Data, class Op>
+class SparseIntervalTree : private impl::OperationHolder<Op> {
+public:
+	using Offset = std::uint64_t;
+	using Operation = Op;
+
+	SparseIntervalTree(Offset size, const Data& identity, Op op = Op())
+		: impl::OperationHolder<Op>(std::move(op))
+		, size_(size) {
+		assert(size > 0);
+		nodes_.push_back(Node{ identity, { 0, 0 } });
+		nodes_.push_back(Node{ identity, { 0, 0 } });
+	}
+
+	void SetAt(Offset offset, const Data& data) {
+		Update(offset, [&data](const Data&) { return data; });
+	}
+
+	// add_front as in BasicIntervalTree::AddAt, for non-commutative Op.
+	void AddAt(Offset offset, const Data& data, bool add_front = false) {
+		Update(offset, [this, &data, add_front](const Data& old) {
+			return add_front ? this->operation()(data, old) : this->operation()(old, data);
+		});
+	}
+
+	Data At(Offset offset) const {
+		return RangeReduce(offset, offset);
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(Offset left, Offset right) const {
+		assert(left <= right);
+		assert(right < size_);
+		return Reduce(kRoot, 0, size_, left, right + 1);
+	}
+
+	// Nodes in use, the sentinel included; each takes sizeof(Data) + 8 bytes.
+	size_t node_count() const { return nodes_.size(); }
+
+	// Makes room for count nodes in total, so a known number of updates does
+	// not reallocate the pool.
+	void Reserve(size_t count) { nodes_.reserve(count); }
+
+	Offset size() const { return size_; }
+
+private:
+	using Index = std::uint32_t;
+
+	struct Node {
+		Data value;
+		Index child[2];
+	};
+
+	static const Index kRoot = 1;
+
+	// Sets the leaf at offset to update(its value), creating the missing
+	// nodes on the way down, and recomputes the path on the way back up.
+	template<class Updater>
+	void Update(Offset offset, const Updater& update) {
+		assert(offset < size_);
+		Index path[64];
+		size_t depth = 0;
+		Index node = kRoot;
+		Offset low = 0;
+		Offset high = size_;
+		while (high - low > 1) {
+			path[depth++] = node;
+			const Offset middle = low + (high - low) / 2;
+			const int side = offset >= middle ? 1 : 0;
+			if (side == 1) {
+				low = middle;
+			}
+			else {
+				high = middle;
+			}
+			Index child = nodes_[node].child[side];
+			if (child == 0) {
+				child = NewNode();
+				nodes_[node].child[side] = child;
+			}
+			node = child;
+		}
+		nodes_[node].value = update(nodes_[node].value);
+		while (depth != 0) {
+			Node& parent = nodes_[path[--depth]];
+			parent.value = this->operation()(nodes_[parent.child[0]].value, nodes_[parent.child[1]].value);
+		}
+	}
+
+	// Throws std::length_error once the 32-bit node indices run out.
+	Index NewNode() {
+		if (nodes_.size() >= std::numeric_limits<Index>::max()) {
+			throw std::length_error("SparseIntervalTree has more nodes than 32-bit indices address.");
+		}
+		nodes_.push_back(Node{ nodes_[0].value, { 0, 0 } });
+		return static_cast<Index>(nodes_.size() - 1);
+	}
+
+	// Reduction of [left, right) within node, which covers [low, high).
+	Data Reduce(Index node, Offset low, Offset high, Offset left, Offset right) const {
+		if (node == 0 || (left <= low && high <= right)) {
+			return nodes_[node].value;
+		}
+		const Offset middle = low + (high - low) / 2;
+		if (right <= middle) {
+			return Reduce(nodes_[node].child[0], low, middle, left, right);
+		}
+		if (left >= middle) {
+			return Reduce(nodes_[node].child[1], middle, high, left, right);
+		}
+		return this->operation()(
+			Reduce(nodes_[node].child[0], low, middle, left, right),
+			Reduce(nodes_[node].child[1], middle, high, left, right));
+	}
+
+	Offset size_;
+	std::vector<Node> nodes_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
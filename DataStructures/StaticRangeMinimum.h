@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+// Range minimum over a fixed array: O(n) build, O(1) queries, no updates.
+// For MinimumIntervalTree instances that are filled once and then only
+// queried.
+//
+// The array is cut into blocks of 64.  Inside a block, masks_[i] has a bit
+// for every j <= i of the same block whose element is not larger than any
+// element in (j, i] (the stack of minima seen from i), so the minimum of
+// [left, i] is at the lowest bit of masks_[i] at or above left.  Across
+// blocks a sparse table over the block minima answers with two overlapping
+// lookups.  Memory is the copy of the data, one 64-bit mask per element and
+// (n / 64) log(n / 64) block minima.
+template<class T>
+class StaticRangeMinimum {
+public:
+	StaticRangeMinimum() : size_(0), blocks_(0) {}
+
+	template<class Iter>
+	StaticRangeMinimum(Iter begin, Iter end) {
+		FillFrom(begin, end);
+	}
+
+	template<class Container>
+	explicit StaticRangeMinimum(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		data_.assign(begin, end);
+		size_ = data_.size();
+		BuildMasks();
+		BuildSparseTable();
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	// left and right - inclusive
+	T RangeReduce(size_t left, size_t right) const {
+		assert(left <= right);
+		assert(right < size_);
+		const size_t left_block = left / kBlock;
+		const size_t right_block = right / kBlock;
+		if (left_block == right_block) {
+			return data_[InBlock(left, right)];
+		}
+		T result = std::min(
+			data_[InBlock(left, left_block * kBlock + kBlock - 1)],
+			data_[InBlock(right_block * kBlock, right)]);
+		if (left_block + 1 < right_block) {
+			result = std::min(result, BetweenBlocks(left_block + 1, right_block - 1));
+		}
+		return result;
+	}
+
+	// Writes RangeReduce(left, right) to out for every (left, right) pair of
+	// [begin, end) and returns the end of the output.  The masks of a query a
+	// few places ahead are prefetched, as in BasicIntervalTree.
+	template<class QueryIter, class OutIter>
+	OutIter BatchRangeReduce(QueryIter begin, QueryIter end, OutIter out) const {
+		QueryIter ahead = begin;
+		for (size_t i = 0; i < kPrefetchDistance && ahead != end; ++i, ++ahead) {
+			Prefetch(ahead->first, ahead->second);
+		}
+		for (QueryIter it = begin; it != end; ++it, ++out) {
+			if (ahead != end) {
+				Prefetch(ahead->first, ahead->second);
+				++ahead;
+			}
+			*out = RangeReduce(it->first, it->second);
+		}
+		return out;
+	}
+
+	template<class Container>
+	std::vector<T> BatchRangeReduce(const Container& queries) const {
+		std::vector<T> results;
+		results.reserve(std::distance(std::begin(queries), std::end(queries)));
+		BatchRangeReduce(std::begin(queries), std::end(queries), std::back_inserter(results));
+		return results;
+	}
+
+	size_t size() const { return size_; }
+
+private:
+	static const size_t kBlock = 64;
+	static const size_t kPrefetchDistance = 8;
+
+	// Offset of the minimum of [left, right], both in one block; the first
+	// one on ties.
+	size_t InBlock(size_t left, size_t right) const {
+		const std::uint64_t mask = masks_[right] & (~std::uint64_t(0) << (left % kBlock));
+		return right / kBlock * kBlock + impl::CountTrailingZeros(mask);
+	}
+
+	// Minimum of the blocks [first, last].
+	T BetweenBlocks(size_t first, size_t last) const {
+		const size_t level = impl::FloorLog2(last - first + 1);
+		const T* row = sparse_.data() + level * blocks_;
+		return std::min(row[first], row[last + 1 - (size_t(1) << level)]);
+	}
+
+	void BuildMasks() {
+		masks_.resize(size_);
+		for (size_t block = 0; block < size_; block += kBlock) {
+			const size_t block_end = std::min(block + kBlock, size_);
+			std::uint64_t stack = 0;
+			for (size_t i = block; i < block_end; ++i) {
+				// Drop the minima above the new element, from the top down.
+				while (stack != 0) {
+					const size_t top = block + impl::FloorLog2(stack);
+					if (!(data_[i] < data_[top])) {
+						break;
+					}
+					stack ^= std::uint64_t(1) << (top - block);
+				}
+				stack |= std::uint64_t(1) << (i - block);
+				masks_[i] = stack;
+			}
+		}
+	}
+
+	void BuildSparseTable() {
+		blocks_ = (size_ + kBlock - 1) / kBlock;
+		if (blocks_ == 0) {
+			sparse_.clear();
+			return;
+		}
+		const size_t levels = impl::FloorLog2(blocks_) + 1;
+		sparse_.resize(levels * blocks_);
+		for (size_t block = 0; block < blocks_; ++block) {
+			const size_t first = block * kBlock;
+			const size_t last = std::min(first + kBlock, size_) - 1;
+			sparse_[block] = data_[InBlock(first, last)];
+		}
+		for (size_t level = 1; level < levels; ++level) {
+			const T* below = sparse_.data() + (level - 1) * blocks_;
+			T* row = sparse_.data() + level * blocks_;
+			const size_t half = size_t(1) << (level - 1);
+			for (size_t block = 0; block + 2 * half <= blocks_; ++block) {
+				row[block] = std::min(below[block], below[block + half]);
+			}
+		}
+	}
+
+	void Prefetch(size_t left, size_t right) const {
+		impl::Prefetch(masks_.data() + std::min(left / kBlock * kBlock + kBlock - 1, right));
+		impl::Prefetch(masks_.data() + right);
+	}
+
+	size_t size_;
+	size_t blocks_;
+	std::vector<T> data_;
+	std::vector<std::uint64_t> masks_;
+	// Level k holds the minimum of blocks [b, b + 2^k) at k * blocks_ + b.
+	std::vector<T> sparse_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
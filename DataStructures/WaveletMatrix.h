@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#include "SimpleIntervalTree.h"
+#include "WideIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+namespace impl {
+
+// Bit vector with O(1) rank and O(log n) select.  Every 64-byte block holds
+// the number of ones before it and the next 448 bits, so a rank reads one
+// cache line: the stored count plus the popcounts of at most 7 words.
+class RankSelectBits {
+public:
+	RankSelectBits() : size_(0), ones_(0) {}
+
+	// size zero bits; set the words, then call BuildRanks before any query.
+	explicit RankSelectBits(size_t size)
+		: size_(size)
+		, ones_(0)
+		, blocks_(size / kBlockBits + 1, Block()) {}
+
+	// Bits [64 * index, 64 * index + 64), the lowest first.
+	void SetWord(size_t index, std::uint64_t word) {
+		assert(index * 64 < size_);
+		blocks_[index / kWords].words[index % kWords] = word;
+	}
+
+	void BuildRanks() {
+		std::uint64_t ones = 0;
+		for (Block& block : blocks_) {
+			block.ones_before = ones;
+			for (std::uint64_t word : block.words) {
+				ones += PopCount(word);
+			}
+		}
+		ones_ = static_cast<size_t>(ones);
+	}
+
+	bool Get(size_t offset) const {
+		assert(offset < size_);
+		const Block& block = blocks_[offset / kBlockBits];
+		return (block.words[offset % kBlockBits / 64] >> (offset % 64)) & 1;
+	}
+
+	// Ones among the first count bits.
+	size_t Rank1(size_t count) const {
+		assert(count <= size_);
+		const Block& block = blocks_[count / kBlockBits];
+		const size_t bits = count % kBlockBits;
+		size_t result = static_cast<size_t>(block.ones_before);
+		for (size_t word = 0; word < bits / 64; ++word) {
+			result += PopCount(block.words[word]);
+		}
+		if (bits % 64 != 0) {
+			result += PopCount(block.words[bits / 64] << (64 - bits % 64));
+		}
+		return result;
+	}
+
+	size_t Rank0(size_t count) const { return count - Rank1(count); }
+
+	// Offset of the k-th (0-based) one; k < ones().
+	size_t Select1(size_t k) const {
+		assert(k < ones_);
+		return Select<true>(k);
+	}
+
+	// Offset of the k-th (0-based) zero; k < size() - ones().
+	size_t Select0(size_t k) const {
+		assert(k < size_ - ones_);
+		return Select<false>(k);
+	}
+
+	size_t size() const { return size_; }
+	size_t ones() const { return ones_; }
+
+private:
+	static const size_t kWords = 7;
+	static const size_t kBlockBits = kWords * 64;
+
+	struct Block {
+		std::uint64_t ones_before;
+		std::uint64_t words[kWords];
+	};
+
+	template<bool one>
+	static size_t Before(const Block& block, size_t index) {
+		return one ? static_cast<size_t>(block.ones_before)
+			: index * kBlockBits - static_cast<size_t>(block.ones_before);
+	}
+
+	// Binary search for the last block with at most k wanted bits before it,
+	// then a scan of its words.
+	template<bool one>
+	size_t Select(size_t k) const {
+		size_t low = 0;
+		size_t high = blocks_.size();
+		while (high - low > 1) {
+			const size_t middle = low + (high - low) / 2;
+			if (Before<one>(blocks_[middle], middle) <= k) {
+				low = middle;
+			}
+			else {
+				high = middle;
+			}
+		}
+		const Block& block = blocks_[low];
+		k -= Before<one>(block, low);
+		for (size_t word = 0;; ++word) {
+			assert(word < kWords);
+			std::uint64_t bits = one ? block.words[word] : ~block.words[word];
+			const size_t count = PopCount(bits);
+			if (k < count) {
+				for (; k != 0; --k) {
+					bits &= bits - 1;
+				}
+				return low * kBlockBits + word * 64 + CountTrailingZeros(bits);
+			}
+			k -= count;
+		}
+	}
+
+	size_t size_;
+	size_t ones_;
+	// One past the last bit there is always a block, so Rank1(size_) is valid.
+	std::vector<Block, AlignedAllocator<Block, 64>> blocks_;
+};
+
+}  // namespace impl
+
+// Order statistics over a fixed array of unsigned integers: k-th smallest,
+// occurrences and number of smaller values in any range, each in O(log
+// sigma) rank operations where sigma is the largest value.  Memory is about
+// 1.15 bits per element and value bit; the values themselves are not kept.
+//
+// Level 0 holds the highest bit of every value.  Each level stably moves the
+// elements with a zero bit in front of those with a one, and the next level
+// holds the next bit in that order, so a range of one level maps to a zero
+// range and a one range of the next through rank.
+template<class T>
+class WaveletMatrix {
+public:
+	static_assert(std::is_integral<T>::value && std::is_unsigned<T>::value, "values are unsigned integers");
+
+	WaveletMatrix() : size_(0), bits_(0) {}
+
+	template<class Iter>
+	WaveletMatrix(Iter begin, Iter end) {
+		FillFrom(begin, end);
+	}
+
+	template<class Container>
+	explicit WaveletMatrix(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		std::vector<T> current(begin, end);
+		size_ = current.size();
+		T largest = 0;
+		for (const T& value : current) {
+			largest = std::max(largest, value);
+		}
+		bits_ = largest == 0 ? 1 : impl::FloorLog2(largest) + 1;
+		levels_.assign(bits_, impl::RankSelectBits());
+		zeros_.assign(bits_, 0);
+		std::vector<T> next(size_);
+		std::vector<T> ones(size_);
+		for (size_t level = 0; level < bits_; ++level) {
+			const size_t bit = bits_ - 1 - level;
+			impl::RankSelectBits& bits = levels_[level];
+			bits = impl::RankSelectBits(size_);
+			// 64 bits at a time into a register, and a branch-free stable
+			// partition into the zeros and the ones of the next level.
+			size_t zero_count = 0;
+			size_t one_count = 0;
+			for (size_t word_begin = 0; word_begin < size_; word_begin += 64) {
+				const size_t word_end = std::min(word_begin + 64, size_);
+				std::uint64_t word = 0;
+				for (size_t i = word_begin; i < word_end; ++i) {
+					const T value = current[i];
+					const size_t is_one = (value >> bit) & 1;
+					word |= std::uint64_t(is_one) << (i - word_begin);
+					next[zero_count] = value;
+					ones[one_count] = value;
+					zero_count += 1 - is_one;
+					one_count += is_one;
+				}
+				bits.SetWord(word_begin / 64, word);
+			}
+			bits.BuildRanks();
+			zeros_[level] = zero_count;
+			std::copy(ones.begin(), ones.begin() + one_count, next.begin() + zero_count);
+			current.swap(next);
+		}
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	T At(size_t offset) const {
+		assert(offset < size_);
+		T result = 0;
+		for (size_t level = 0; level < bits_; ++level) {
+			const impl::RankSelectBits& bits = levels_[level];
+			if (bits.Get(offset)) {
+				result |= T(1) << (bits_ - 1 - level);
+				offset = zeros_[level] + bits.Rank1(offset);
+			}
+			else {
+				offset = bits.Rank0(offset);
+			}
+		}
+		return result;
+	}
+
+	// The k-th (0-based) smallest value of the range; k <= right - left.
+	// left and right - inclusive
+	T RangeKthSmallest(size_t left, size_t right, size_t k) const {
+		assert(left <= right);
+		assert(right < size_);
+		assert(k <= right - left);
+		size_t begin = left;
+		size_t end = right + 1;
+		T result = 0;
+		for (size_t level = 0; level < bits_; ++level) {
+			const impl::RankSelectBits& bits = levels_[level];
+			const size_t zero_begin = bits.Rank0(begin);
+			const size_t zero_end = bits.Rank0(end);
+			if (k < zero_end - zero_begin) {
+				begin = zero_begin;
+				end = zero_end;
+			}
+			else {
+				k -= zero_end - zero_begin;
+				begin = zeros_[level] + (begin - zero_begin);
+				end = zeros_[level] + (end - zero_end);
+				result |= T(1) << (bits_ - 1 - level);
+			}
+		}
+		return result;
+	}
+
+	// Occurrences of value in the range.
+	// left and right - inclusive
+	size_t RangeCount(size_t left, size_t right, T value) const {
+		assert(left <= right);
+		assert(right < size_);
+		if (!Fits(value)) {
+			return 0;
+		}
+		size_t begin = left;
+		size_t end = right + 1;
+		for (size_t level = 0; level < bits_ && begin != end; ++level) {
+			Descend(level, value, &begin, &end);
+		}
+		return end - begin;
+	}
+
+	// Number of values less than value in the range.
+	// left and right - inclusive
+	size_t RangeCountLess(size_t left, size_t right, T value) const {
+		assert(left <= right);
+		assert(right < size_);
+		if (!Fits(value)) {
+			return right - left + 1;
+		}
+		size_t begin = left;
+		size_t end = right + 1;
+		size_t result = 0;
+		for (size_t level = 0; level < bits_ && begin != end; ++level) {
+			if ((value >> (bits_ - 1 - level)) & 1) {
+				result += levels_[level].Rank0(end) - levels_[level].Rank0(begin);
+			}
+			Descend(level, value, &begin, &end);
+		}
+		return result;
+	}
+
+	// Offset of the k-th (0-based) occurrence of value, or size() if there
+	// are not that many.
+	size_t Select(T value, size_t k) const {
+		if (!Fits(value)) {
+			return size_;
+		}
+		size_t begin = 0;
+		size_t end = size_;
+		for (size_t level = 0; level < bits_; ++level) {
+			Descend(level, value, &begin, &end);
+		}
+		if (k >= end - begin) {
+			return size_;
+		}
+		size_t offset = begin + k;
+		for (size_t level = bits_; level-- != 0;) {
+			if ((value >> (bits_ - 1 - level)) & 1) {
+				offset = levels_[level].Select1(offset - zeros_[level]);
+			}
+			else {
+				offset = levels_[level].Select0(offset);
+			}
+		}
+		return offset;
+	}
+
+	size_t size() const { return size_; }
+
+private:
+	bool Fits(T value) const {
+		return bits_ >= sizeof(T) * 8 || (value >> bits_) == 0;
+	}
+
+	// Maps [*begin, *end) of level to the elements of the next level that
+	// have value's bit of this level.
+	void Descend(size_t level, T value, size_t* begin, size_t* end) const {
+		const impl::RankSelectBits& bits = levels_[level];
+		if ((value >> (bits_ - 1 - level)) & 1) {
+			*begin = zeros_[level] + bits.Rank1(*begin);
+			*end = zeros_[level] + bits.Rank1(*end);
+		}
+		else {
+			*begin = bits.Rank0(*begin);
+			*end = bits.Rank0(*end);
+		}
+	}
+
+	size_t size_;
+	size_t bits_;
+	std::vector<impl::RankSelectBits> levels_;
+	// Elements with a zero bit at each level; they come first in the next.
+	std::vector<size_t> zeros_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <cassert>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "SimpleIntervalTree.h"
+
+namespace data_structures {
+namespace interval_trees {
+
+namespace impl {
+
+// std::allocator with the storage aligned to alignment bytes, so a node of a
+// wide tree starts on a cache line.
+template<class T, size_t alignment>
+class AlignedAllocator {
+public:
+	using value_type = T;
+	template<class U>
+	struct rebind {
+		using other = AlignedAllocator<U, alignment>;
+	};
+
+	AlignedAllocator() = default;
+	template<class U>
+	AlignedAllocator(const AlignedAllocator<U, alignment>&) {}
+
+	T* allocate(size_t count) {
+#ifdef _MSC_VER
+		void* memory = _aligned_malloc(count * sizeof(T), alignment);
+#else
+		void* memory = nullptr;
+		if (posix_memalign(&memory, alignment, count * sizeof(T)) != 0) {
+			memory = nullptr;
+		}
+#endif
+		if (memory == nullptr) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(memory);
+	}
+
+	void deallocate(T* memory, size_t) {
+#ifdef _MSC_VER
+		_aligned_free(memory);
+#else
+		free(memory);
+#endif
+	}
+
+	template<class U>
+	bool operator==(const AlignedAllocator<U, alignment>&) const { return true; }
+	template<class U>
+	bool operator!=(const AlignedAllocator<U, alignment>&) const { return false; }
+};
+
+// Reduces node[from, to) of a wide tree node, from < to <= 16, in order.
+template<class Data, class Op>
+struct NodeReducer {
+	static Data Reduce(const Data* node, size_t from, size_t to, const Op& op) {
+		Data result = node[from];
+		for (size_t i = from + 1; i < to; ++i) {
+			result = op(result, node[i]);
+		}
+		return result;
+	}
+};
+
+#ifdef __AVX2__
+// A 16-int node is two AVX2 registers; lanes outside [from, to) are replaced
+// by the identity of the operation before the horizontal reduction.
+struct Avx2IntNode {
+	static __m256i Lanes(size_t from, size_t to, size_t offset) {
+		const __m256i index = _mm256_add_epi32(
+			_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+			_mm256_set1_epi32(static_cast<int>(offset)));
+		const __m256i above_from = _mm256_cmpgt_epi32(index, _mm256_set1_epi32(static_cast<int>(from) - 1));
+		const __m256i below_to = _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<int>(to)), index);
+		return _mm256_and_si256(above_from, below_to);
+	}
+
+	template<class Combine>
+	static int Reduce(const int* node, size_t from, size_t to, int identity, Combine combine) {
+		const __m256i fill = _mm256_set1_epi32(identity);
+		__m256i low = _mm256_load_si256(reinterpret_cast<const __m256i*>(node));
+		__m256i high = _mm256_load_si256(reinterpret_cast<const __m256i*>(node + 8));
+		if (from != 0 || to != 16) {
+			low = _mm256_blendv_epi8(fill, low, Lanes(from, to, 0));
+			high = _mm256_blendv_epi8(fill, high, Lanes(from, to, 8));
+		}
+		__m256i x = combine(low, high);
+		__m128i y = combine(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+		y = combine(y, _mm_shuffle_epi32(y, _MM_SHUFFLE(1, 0, 3, 2)));
+		y = combine(y, _mm_shuffle_epi32(y, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(y);
+	}
+};
+
+struct Avx2Min {
+	__m256i operator()(__m256i a, __m256i b) const { return _mm256_min_epi32(a, b); }
+	__m128i operator()(__m128i a, __m128i b) const { return _mm_min_epi32(a, b); }
+};
+
+struct Avx2Max {
+	__m256i operator()(__m256i a, __m256i b) const { return _mm256_max_epi32(a, b); }
+	__m128i operator()(__m128i a, __m128i b) const { return _mm_max_epi32(a, b); }
+};
+
+struct Avx2Add {
+	__m256i operator()(__m256i a, __m256i b) const { return _mm256_add_epi32(a, b); }
+	__m128i operator()(__m128i a, __m128i b) const { return _mm_add_epi32(a, b); }
+};
+
+template<>
+struct NodeReducer<int, MinOp<int>> {
+	static int Reduce(const int* node, size_t from, size_t to, const MinOp<int>&) {
+		return Avx2IntNode::Reduce(node, from, to, std::numeric_limits<int>::max(), Avx2Min());
+	}
+};
+
+template<>
+struct NodeReducer<int, MaxOp<int>> {
+	static int Reduce(const int* node, size_t from, size_t to, const MaxOp<int>&) {
+		return Avx2IntNode::Reduce(node, from, to, std::numeric_limits<int>::min(), Avx2Max());
+	}
+};
+
+template<>
+struct NodeReducer<int, SumOp<int>> {
+	static int Reduce(const int* node, size_t from, size_t to, const SumOp<int>&) {
+		return Avx2IntNode::Reduce(node, from, to, 0, Avx2Add());
+	}
+};
+#endif
+
+}  // namespace impl
+
+// Segment tree with 16 children per node instead of 2.  Each layer is stored
+// contiguously, leaves first, and every node starts on a 64-byte boundary, so
+// a node of ints is exactly one cache line and a root-to-leaf path touches
+// log16(n) lines instead of log2(n).  Nodes are reduced with AVX2 for
+// MinOp, MaxOp and SumOp over int when the compiler targets it, and with a
+// plain loop otherwise.
+//
+// Same interface as BasicIntervalTree; Op needs no identity and the order of
+// the operands is kept.
+template<class Data, class Op>
+class WideIntervalTree : private impl::OperationHolder<Op> {
+public:
+	using Operation = Op;
+	static const size_t kBranching = 16;
+
+	WideIntervalTree(size_t size, const Data& default_value, Op op = Op())
+		: impl::OperationHolder<Op>(std::move(op))
+		, size_(size) {
+		assert(size > 0);
+		size_t total = 0;
+		size_t count = size;
+		do {
+			count = (count + kBranching - 1) / kBranching;
+			layer_begin_.push_back(total);
+			total += count * kBranching;
+		} while (count > 1);
+		tree_.assign(total, default_value);
+		RecomputeLayers();
+	}
+
+	template<class Iter>
+	void FillFrom(Iter begin, Iter end) {
+		assert(static_cast<size_t>(std::distance(begin, end)) <= size_);
+		std::copy(begin, end, tree_.begin());
+		RecomputeLayers();
+	}
+
+	template<class Container>
+	void FillFrom(const Container& cont) {
+		FillFrom(std::begin(cont), std::end(cont));
+	}
+
+	template<class InitializerListData>
+	void FillFrom(std::initializer_list<InitializerListData> initializer_list) {
+		FillFrom(std::begin(initializer_list), std::end(initializer_list));
+	}
+
+	void SetAt(size_t offset, const Data& data) {
+		assert(offset < size_);
+		tree_[offset] = data;
+		for (size_t layer = 1; layer < layer_begin_.size(); ++layer) {
+			offset /= kBranching;
+			tree_[layer_begin_[layer] + offset] = ReduceNode(layer - 1, offset, 0, kBranching);
+		}
+	}
+
+	// left and right - inclusive
+	Data RangeReduce(size_t left, size_t right) {
+		assert(right < size_);
+		assert(left <= right);
+		// Partial nodes at the borders are reduced on each layer, the whole
+		// nodes between them are left to the layer above.
+		Data left_slope = Data();
+		Data right_slope = Data();
+		bool has_left = false;
+		bool has_right = false;
+		for (size_t layer = 0;; ++layer) {
+			size_t left_node = left / kBranching;
+			size_t right_node = right / kBranching;
+			if (left_node == right_node) {
+				Data middle = ReduceNode(layer, left_node, left % kBranching, right % kBranching + 1);
+				if (has_left) {
+					middle = this->operation()(left_slope, middle);
+				}
+				if (has_right) {
+					middle = this->operation()(middle, right_slope);
+				}
+				return middle;
+			}
+			if (left % kBranching != 0) {
+				const Data part = ReduceNode(layer, left_node, left % kBranching, kBranching);
+				left_slope = has_left ? this->operation()(left_slope, part) : part;
+				has_left = true;
+				++left_node;
+			}
+			if (right % kBranching != kBranching - 1) {
+				const Data part = ReduceNode(layer, right_node, 0, right % kBranching + 1);
+				right_slope = has_right ? this->operation()(part, right_slope) : part;
+				has_right = true;
+				--right_node;
+			}
+			if (left_node > right_node) {
+				// Two neighbouring partial nodes, nothing in between.
+				return this->operation()(left_slope, right_slope);
+			}
+			left = left_node;
+			right = right_node;
+		}
+	}
+
+	// The first offset right >= left at which pred(RangeReduce(left, right))
+	// turns false, or size() if it never does; pred must be monotone.  Climbs
+	// while whole sibling groups pass, then descends into the node where pred
+	// fails: at most 16 steps per layer each way.  The leaves past size()
+	// hold default_value, which should be the identity of Op.
+	template<class Predicate>
+	size_t MaxRight(size_t left, Predicate pred) {
+		assert(left <= size_);
+		if (left == size_) {
+			return size_;
+		}
+		Data slope = Data();
+		bool has_slope = false;
+		const auto extend = [this, &slope, &has_slope](size_t layer, size_t index) {
+			const Data& node = tree_[layer_begin_[layer] + index];
+			return has_slope ? this->operation()(slope, node) : node;
+		};
+		size_t index = left;
+		for (size_t layer = 0; layer < layer_begin_.size(); ++layer) {
+			const size_t group_end = (index / kBranching + 1) * kBranching;
+			for (; index < group_end; ++index) {
+				Data candidate = extend(layer, index);
+				if (!pred(candidate)) {
+					// The answer is inside this node; find it layer by layer.
+					while (layer != 0) {
+						--layer;
+						index *= kBranching;
+						for (;; ++index) {
+							candidate = extend(layer, index);
+							if (!pred(candidate)) {
+								break;
+							}
+							slope = std::move(candidate);
+							has_slope = true;
+						}
+					}
+					return std::min(index, size_);
+				}
+				slope = std::move(candidate);
+				has_slope = true;
+			}
+			index = group_end / kBranching;
+			if (layer + 1 < layer_begin_.size() && index >= LayerSize(layer + 1)) {
+				// Everything up to the last leaf passed.
+				return size_;
+			}
+		}
+		return size_;
+	}
+
+	// The mirror of MaxRight: the smallest left <= right + 1 such that
+	// pred(RangeReduce(l, right)) holds for every l in [left, right].
+	template<class Predicate>
+	size_t MinLeft(size_t right, Predicate pred) {
+		assert(right < size_);
+		Data slope = Data();
+		bool has_slope = false;
+		const auto extend = [this, &slope, &has_slope](size_t layer, size_t index) {
+			const Data& node = tree_[layer_begin_[layer] + index];
+			return has_slope ? this->operation()(node, slope) : node;
+		};
+		// end is one past the nodes left to look at on this layer.
+		size_t end = right + 1;
+		for (size_t layer = 0; layer < layer_begin_.size(); ++layer) {
+			const size_t group_begin = (end - 1) / kBranching * kBranching;
+			for (; end > group_begin; --end) {
+				Data candidate = extend(layer, end - 1);
+				if (!pred(candidate)) {
+					while (layer != 0) {
+						--layer;
+						end *= kBranching;
+						for (;; --end) {
+							candidate = extend(layer, end - 1);
+							if (!pred(candidate)) {
+								break;
+							}
+							slope = std::move(candidate);
+							has_slope = true;
+						}
+					}
+					return end;
+				}
+				slope = std::move(candidate);
+				has_slope = true;
+			}
+			if (group_begin == 0) {
+				return 0;
+			}
+			end = group_begin / kBranching;
+		}
+		return 0;
+	}
+
+	size_t size() const { return size_; }
+
+private:
+	Data ReduceNode(size_t layer, size_t node, size_t from, size_t to) const {
+		return impl::NodeReducer<Data, Op>::Reduce(
+			tree_.data() + layer_begin_[layer] + node * kBranching, from, to, this->operation());
+	}
+
+	// Number of nodes stored for layer, padding included.
+	size_t LayerSize(size_t layer) const {
+		return (layer + 1 < layer_begin_.size() ? layer_begin_[layer + 1] : tree_.size()) - layer_begin_[layer];
+	}
+
+	void RecomputeLayers() {
+		for (size_t layer = 1; layer < layer_begin_.size(); ++layer) {
+			const size_t count = (layer_begin_[layer] - layer_begin_[layer - 1]) / kBranching;
+			for (size_t node = 0; node < count; ++node) {
+				tree_[layer_begin_[layer] + node] = ReduceNode(layer - 1, node, 0, kBranching);
+			}
+		}
+	}
+
+	size_t size_;
+	// Where each layer starts in tree_, leaves first; the last one is a
+	// single node.
+	std::vector<size_t> layer_begin_;
+	std::vector<Data, impl::AlignedAllocator<Data, 64>> tree_;
+};
+
+}  // namespace interval_trees
+}  // namespace data_structures
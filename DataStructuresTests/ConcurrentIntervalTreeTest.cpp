@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/ConcurrentIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(ConcurrentIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(ParallelUpdatesTest)
+		{
+			using namespace data_structures::interval_trees;
+			const size_t size = 100;
+			ConcurrentIntervalTree<long long> sum(size, 0);
+			ConcurrentIntervalTree<int, MinOp<int>> minimum(size, 1000000);
+			std::vector<std::thread> writers;
+			for (int thread = 0; thread < 4; ++thread) {
+				writers.emplace_back([&sum, &minimum, thread]() {
+					std::mt19937 gen(thread);
+					for (int step = 0; step < 10000; ++step) {
+						const size_t offset = gen() % size;
+						sum.AddAt(offset, 1);
+						minimum.AddAt(offset, static_cast<int>(gen() % 1000000));
+						if (offset % 4 == static_cast<size_t>(thread)) {
+							sum.SetAt(offset, 5);
+						}
+					}
+				});
+			}
+			for (auto& writer : writers) {
+				writer.join();
+			}
+
+			std::vector<long long> sums(size);
+			std::vector<int> minimums(size);
+			for (size_t i = 0; i < size; ++i) {
+				sums[i] = sum.At(i);
+				minimums[i] = minimum.At(i);
+			}
+			for (size_t left = 0; left < size; ++left) {
+				for (size_t right = left; right < size; right += 3) {
+					Assert::AreEqual(
+						std::accumulate(sums.begin() + left, sums.begin() + right + 1, 0LL),
+						sum.RangeReduce(left, right));
+					Assert::AreEqual(
+						*std::min_element(minimums.begin() + left, minimums.begin() + right + 1),
+						minimum.RangeReduce(left, right));
+				}
+			}
+		}
+
+		TEST_METHOD(SequentialTest)
+		{
+			using namespace data_structures::interval_trees;
+			ConcurrentIntervalTree<int> tree(10, 0);
+			tree.FillFrom({ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 });
+			tree.SetAt(4, -5);
+			tree.AddAt(9, 10);
+			Assert::AreEqual(55, tree.RangeReduce(0, 9));
+			Assert::AreEqual(5, tree.RangeReduce(3, 5));
+			Assert::AreEqual(20, tree.At(9));
+		}
+
+	};
+}
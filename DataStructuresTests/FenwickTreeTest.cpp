@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/FenwickTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(FenwickTreeTests)
+	{
+	public:
+
+		TEST_METHOD(PointUpdateRangeSumTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (size_t size : { 1, 2, 7, 64, 100 }) {
+				FenwickTree<long long> tree(size);
+				std::vector<long long> values(size);
+				std::iota(values.begin(), values.end(), 1);
+				tree.FillFrom(values);
+				for (int step = 0; step < 2000; ++step) {
+					size_t left = gen() % size;
+					size_t right = gen() % size;
+					if (left > right) std::swap(left, right);
+					const long long value = static_cast<long long>(gen() % 100);
+					switch (gen() % 4) {
+					case 0:
+						tree.AddAt(left, value);
+						values[left] += value;
+						break;
+					case 1:
+						tree.SetAt(right, value);
+						values[right] = value;
+						break;
+					case 2:
+						Assert::AreEqual(
+							std::accumulate(values.begin() + left, values.begin() + right + 1, 0LL),
+							tree.RangeReduce(left, right));
+						break;
+					default: {
+						const long long total = std::accumulate(values.begin(), values.end(), 0LL);
+						const long long target = static_cast<long long>(gen() % (total + 2));
+						std::vector<long long> prefix(size);
+						std::partial_sum(values.begin(), values.end(), prefix.begin());
+						const size_t expected = std::lower_bound(prefix.begin(), prefix.end(), target) - prefix.begin();
+						Assert::AreEqual(expected, tree.LowerBound(target));
+					}
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(RangeAddRangeSumTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(2);
+			for (size_t size : { 1, 2, 7, 64, 100 }) {
+				RangeAddFenwickTree<long long> tree(size);
+				std::vector<long long> values(size);
+				std::iota(values.begin(), values.end(), -5);
+				tree.FillFrom(values);
+				for (int step = 0; step < 2000; ++step) {
+					size_t left = gen() % size;
+					size_t right = gen() % size;
+					if (left > right) std::swap(left, right);
+					if (gen() % 2 == 0) {
+						const long long value = static_cast<long long>(gen() % 21) - 10;
+						tree.RangeAdd(left, right, value);
+						for (size_t i = left; i <= right; ++i) {
+							values[i] += value;
+						}
+					}
+					else {
+						Assert::AreEqual(
+							std::accumulate(values.begin() + left, values.begin() + right + 1, 0LL),
+							tree.RangeSum(left, right));
+					}
+				}
+			}
+		}
+
+	};
+}
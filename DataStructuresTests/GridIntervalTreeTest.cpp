@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/GridIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(GridIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(RectangleReduceTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (size_t rows : { 1, 5, 16 }) {
+				for (size_t columns : { 1, 7, 16 }) {
+					std::vector<long long> grid(rows * columns);
+					for (auto& value : grid) value = gen() % 100;
+					std::vector<long long> maximum_grid = grid;
+					GridIntervalTree<long long, SumOp<long long>> sums(rows, columns, 0);
+					GridIntervalTree<long long, MaxOp<long long>> maximums(rows, columns, -1);
+					sums.FillFrom(grid);
+					maximums.FillFrom(grid);
+					for (int step = 0; step < 300; ++step) {
+						size_t top = gen() % rows;
+						size_t left = gen() % columns;
+						size_t bottom = gen() % rows;
+						size_t right = gen() % columns;
+						const long long value = gen() % 100;
+						if (step % 3 == 0) {
+							sums.SetAt(top, left, value);
+							maximums.SetAt(top, left, value);
+							grid[top * columns + left] = value;
+							maximum_grid[top * columns + left] = value;
+							continue;
+						}
+						if (step % 3 == 1) {
+							sums.AddAt(top, left, value);
+							maximums.AddAt(top, left, value);
+							grid[top * columns + left] += value;
+							maximum_grid[top * columns + left] = std::max(maximum_grid[top * columns + left], value);
+							Assert::AreEqual(grid[top * columns + left], sums.At(top, left));
+							continue;
+						}
+						if (top > bottom) std::swap(top, bottom);
+						if (left > right) std::swap(left, right);
+						long long sum = 0;
+						long long maximum = -1;
+						for (size_t row = top; row <= bottom; ++row) {
+							for (size_t column = left; column <= right; ++column) {
+								sum += grid[row * columns + column];
+								maximum = std::max(maximum, maximum_grid[row * columns + column]);
+							}
+						}
+						Assert::AreEqual(sum, sums.RangeReduce(top, left, bottom, right));
+						Assert::AreEqual(maximum, maximums.RangeReduce(top, left, bottom, right));
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(CompressedGridFenwickTreeTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(2);
+			std::vector<std::pair<long long, long long>> points(300);
+			for (auto& point : points) {
+				point.first = static_cast<long long>(gen() % 50) * 1000000007LL - 20000000000LL;
+				point.second = static_cast<long long>(gen() % 50) - 25;
+			}
+			CompressedGridFenwickTree<long long> tree(points);
+			std::vector<long long> values(points.size(), 0);
+			for (size_t i = 0; i < points.size(); ++i) {
+				values[i] = gen() % 100;
+				tree.AddAt(points[i].first, points[i].second, values[i]);
+			}
+			tree.SetAt(points[0].first, points[0].second, 7);
+			for (size_t i = 0; i < points.size(); ++i) {
+				if (points[i] == points[0]) values[i] = 0;
+			}
+			values[0] = 7;
+			for (int step = 0; step < 300; ++step) {
+				const auto& a = points[gen() % points.size()];
+				const auto& b = points[gen() % points.size()];
+				const long long x_low = std::min(a.first, b.first);
+				const long long x_high = std::max(a.first, b.first);
+				const long long y_low = std::min(a.second, b.second) - step % 2;
+				const long long y_high = std::max(a.second, b.second);
+				long long expected = 0;
+				for (size_t i = 0; i < points.size(); ++i) {
+					if (x_low <= points[i].first && points[i].first <= x_high &&
+						y_low <= points[i].second && points[i].second <= y_high) {
+						expected += values[i];
+					}
+				}
+				Assert::AreEqual(expected, tree.RangeReduce(x_low, y_low, x_high, y_high));
+			}
+		}
+
+	};
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <CppUnitTest.h>
+#include "../DataStructures/LazyIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(LazyIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(RangeAddSumTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (size_t size : { 1, 2, 7, 64, 100 }) {
+				LazyIntervalTree<long long, SumOp<long long>, RangeAdd<long long, true>> tree(size, 0);
+				std::vector<long long> values(size);
+				std::iota(values.begin(), values.end(), -3);
+				tree.FillFrom(values);
+				for (int step = 0; step < 2000; ++step) {
+					size_t left = gen() % size;
+					size_t right = gen() % size;
+					if (left > right) std::swap(left, right);
+					const long long value = static_cast<long long>(gen() % 21) - 10;
+					switch (gen() % 3) {
+					case 0:
+						tree.RangeUpdate(left, right, value);
+						for (size_t i = left; i <= right; ++i) values[i] += value;
+						break;
+					case 1:
+						tree.SetAt(left, value);
+						values[left] = value;
+						break;
+					default:
+						Assert::AreEqual(
+							std::accumulate(values.begin() + left, values.begin() + right + 1, 0LL),
+							tree.RangeReduce(left, right));
+						Assert::AreEqual(values[right], tree.At(right));
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(RangeAssignMinTest)
+		{
+			using namespace data_structures::interval_trees;
+			using Assign = RangeAssign<int, false>;
+			std::mt19937 gen(2);
+			const size_t size = 37;
+			LazyIntervalTree<int, MinOp<int>, Assign> tree(size, std::numeric_limits<int>::max());
+			std::vector<int> values(size, std::numeric_limits<int>::max());
+			for (int step = 0; step < 5000; ++step) {
+				size_t left = gen() % size;
+				size_t right = gen() % size;
+				if (left > right) std::swap(left, right);
+				if (gen() % 2) {
+					const int value = static_cast<int>(gen() % 1000);
+					tree.RangeUpdate(left, right, Assign::To(value));
+					std::fill(values.begin() + left, values.begin() + right + 1, value);
+				}
+				else {
+					Assert::AreEqual(
+						*std::min_element(values.begin() + left, values.begin() + right + 1),
+						tree.RangeReduce(left, right));
+				}
+			}
+		}
+
+
+		TEST_METHOD(MaxRightMinLeftTest)
+		{
+			using namespace data_structures::interval_trees;
+			const size_t size = 100;
+			LazyIntervalTree<int, MinOp<int>, RangeAssign<int, false>> tree(size, std::numeric_limits<int>::max());
+			std::vector<int> values(size, 10);
+			tree.FillFrom(values);
+			tree.RangeUpdate(20, 29, RangeAssign<int, false>::To(3));
+			tree.RangeUpdate(60, 60, RangeAssign<int, false>::To(1));
+			std::fill(values.begin() + 20, values.begin() + 30, 3);
+			values[60] = 1;
+			for (int threshold : { 1, 2, 5 }) {
+				const auto above = [threshold](int minimum) { return minimum >= threshold; };
+				for (size_t offset = 0; offset < size; offset += 3) {
+					size_t right = offset;
+					while (right < size && values[right] >= threshold) ++right;
+					Assert::AreEqual(right, tree.MaxRight(offset, above));
+					size_t left = offset + 1;
+					while (left > 0 && values[left - 1] >= threshold) --left;
+					Assert::AreEqual(left, tree.MinLeft(offset, above));
+				}
+			}
+		}
+
+	};
+}
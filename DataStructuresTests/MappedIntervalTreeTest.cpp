@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/MappedIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(MappedIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(SaveLoadTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (TreeLayout layout : { TreeLayout::PowerOfTwo, TreeLayout::Compact }) {
+				std::vector<long long> values(1000);
+				for (auto& value : values) value = gen() % 1000;
+				BasicIntervalTree<long long, SumOp<long long>> tree(values.size(), 0, SumOp<long long>(), layout);
+				tree.FillFrom(values);
+				std::stringstream snapshot;
+				tree.Save(snapshot);
+
+				BasicIntervalTree<long long, SumOp<long long>> loaded(1, 0);
+				loaded.Load(snapshot);
+				Assert::AreEqual(values.size(), loaded.size());
+				for (int step = 0; step < 300; ++step) {
+					size_t left = gen() % values.size();
+					size_t right = gen() % values.size();
+					if (left > right) std::swap(left, right);
+					Assert::AreEqual(tree.RangeReduce(left, right), loaded.RangeReduce(left, right));
+				}
+				loaded.SetAt(5, 1000000);
+				Assert::AreEqual(tree.RangeReduce(0, 999) - values[5] + 1000000, loaded.RangeReduce(0, 999));
+			}
+		}
+
+		TEST_METHOD(RejectsBadSnapshotsTest)
+		{
+			using namespace data_structures::interval_trees;
+			BasicIntervalTree<int, MaxOp<int>> tree(10, 0);
+			tree.SetAt(3, 7);
+			std::stringstream snapshot;
+			tree.Save(snapshot);
+			const std::string bytes = snapshot.str();
+
+			BasicIntervalTree<long long, MaxOp<long long>> wrong_data(10, 0);
+			std::stringstream same(bytes);
+			Assert::ExpectException<std::invalid_argument>([&] { wrong_data.Load(same); });
+
+			BasicIntervalTree<int, MaxOp<int>> loaded(4, 0);
+			std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+			Assert::ExpectException<std::invalid_argument>([&] { loaded.Load(truncated); });
+			std::stringstream garbage(std::string(bytes.size(), 'x'));
+			Assert::ExpectException<std::invalid_argument>([&] { loaded.Load(garbage); });
+			Assert::AreEqual(size_t(4), loaded.size());
+		}
+
+		TEST_METHOD(MappedQueriesTest)
+		{
+			using namespace data_structures::interval_trees;
+			const std::string path = "MappedIntervalTreeTest.snapshot";
+			std::mt19937 gen(2);
+			std::vector<int> values(777);
+			for (auto& value : values) value = static_cast<int>(gen() % 1000000);
+			MinimumIntervalTree<int> tree(values.size());
+			tree.FillFrom(values);
+			{
+				std::ofstream out(path, std::ios::binary);
+				tree.Save(out);
+			}
+			{
+				MappedIntervalTree<int, MinOp<int>> mapped(path);
+				Assert::AreEqual(values.size(), mapped.size());
+				for (size_t i = 0; i < values.size(); ++i) {
+					Assert::AreEqual(values[i], mapped.At(i));
+				}
+				for (int step = 0; step < 300; ++step) {
+					size_t left = gen() % values.size();
+					size_t right = gen() % values.size();
+					if (left > right) std::swap(left, right);
+					Assert::AreEqual(tree.RangeReduce(left, right), mapped.RangeReduce(left, right));
+				}
+				Assert::ExpectException<std::invalid_argument>([&] { MappedIntervalTree<double, MinOp<double>> other(path); });
+			}
+			std::remove(path.c_str());
+			Assert::ExpectException<std::runtime_error>([&] { MappedIntervalTree<int, MinOp<int>> missing(path); });
+		}
+
+	};
+}
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/PersistentIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(PersistentIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(KeepsOldVersionsTest)
+		{
+			using namespace data_structures::interval_trees;
+			const size_t size = 37;
+			PersistentIntervalTree<long long, SumOp<long long>> tree(size, 1);
+			Assert::IsTrue(tree.node_count() < 20);
+			std::vector<decltype(tree.Initial())> versions{ tree.Initial() };
+			std::vector<std::vector<long long>> arrays{ std::vector<long long>(size, 1) };
+			std::mt19937 gen(1);
+			for (int step = 0; step < 300; ++step) {
+				const size_t base = gen() % versions.size();
+				std::vector<long long> array = arrays[base];
+				const size_t offset = gen() % size;
+				const long long value = gen() % 100;
+				if (step % 50 == 0) {
+					for (auto& element : array) element = gen() % 100;
+					versions.push_back(tree.Build(array));
+				}
+				else if (step % 2 == 0) {
+					versions.push_back(tree.SetAt(versions[base], offset, value));
+					array[offset] = value;
+				}
+				else {
+					versions.push_back(tree.AddAt(versions[base], offset, value));
+					array[offset] += value;
+				}
+				arrays.push_back(array);
+			}
+			for (size_t version = 0; version < versions.size(); ++version) {
+				for (size_t left = 0; left < size; left += 3) {
+					for (size_t right = left; right < size; right += 5) {
+						long long expected = 0;
+						for (size_t i = left; i <= right; ++i) expected += arrays[version][i];
+						Assert::AreEqual(expected, tree.RangeReduce(versions[version], left, right));
+					}
+					Assert::AreEqual(arrays[version][left], tree.At(versions[version], left));
+				}
+			}
+		}
+
+		TEST_METHOD(SetAllTest)
+		{
+			using namespace data_structures::interval_trees;
+			auto concat = [](const std::string& a, const std::string& b) { return a + b; };
+			PersistentIntervalTree<std::string, decltype(concat)> tree(4, "", concat);
+			const std::vector<std::pair<size_t, std::string>> updates{ { 1, "a" }, { 3, "b" }, { 1, "c" }, { 0, "d" } };
+			const auto versions = tree.SetAll(tree.Initial(), updates.begin(), updates.end());
+			Assert::AreEqual(size_t(4), versions.size());
+			Assert::AreEqual(std::string("a"), tree.RangeReduce(versions[0], 0, 3));
+			Assert::AreEqual(std::string("ab"), tree.RangeReduce(versions[1], 0, 3));
+			Assert::AreEqual(std::string("cb"), tree.RangeReduce(versions[2], 0, 3));
+			Assert::AreEqual(std::string("dcb"), tree.RangeReduce(versions[3], 0, 3));
+			Assert::AreEqual(std::string(), tree.RangeReduce(tree.Initial(), 0, 3));
+			const auto front = tree.AddAt(versions[3], 1, "x", true);
+			Assert::AreEqual(std::string("dxcb"), tree.RangeReduce(front, 0, 3));
+		}
+
+		TEST_METHOD(KthSmallestInRangeTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(2);
+			std::vector<int> values(200);
+			for (auto& value : values) value = gen() % 50;
+			std::vector<int> sorted = values;
+			std::sort(sorted.begin(), sorted.end());
+			// prefixes[i] counts the ranks of the first i values.
+			PersistentIntervalTree<int, SumOp<int>> counts(values.size(), 0);
+			std::vector<decltype(counts.Initial())> prefixes{ counts.Initial() };
+			for (int value : values) {
+				const size_t rank = std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin();
+				prefixes.push_back(counts.AddAt(prefixes.back(), rank, 1));
+			}
+			for (int query = 0; query < 500; ++query) {
+				size_t left = gen() % values.size();
+				size_t right = gen() % values.size();
+				if (left > right) std::swap(left, right);
+				std::vector<int> window(values.begin() + left, values.begin() + right + 1);
+				std::sort(window.begin(), window.end());
+				const int k = gen() % window.size();
+				Assert::AreEqual(window[k], sorted[counts.KthInDifference(prefixes[left], prefixes[right + 1], k)]);
+			}
+		}
+
+	};
+}
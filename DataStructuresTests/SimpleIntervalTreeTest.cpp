@@ -1,5 +1,8 @@
 #include <algorithm>
 #include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
 #include <CppUnitTest.h>
 #include "../DataStructures/SimpleIntervalTree.h"
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -27,5 +30,111 @@ namespace DataStructuresTests
 			Assert::AreEqual(1, (int)tree.RangeReduce(2, 2));
 		}
 
+		TEST_METHOD(BasicIntervalTreeTest)
+		{
+			using namespace data_structures::interval_trees;
+			static_assert(
+				sizeof(BasicIntervalTree<int, SumOp<int>>) < sizeof(SimpleIntervalTree<int>),
+				"A stateless operation should take no space");
+			BasicIntervalTree<long long, SumOp<long long>> tree(10, 0);
+			std::vector<long long> values(10);
+			std::iota(values.begin(), values.end(), 1);
+			tree.FillFrom(values);
+			tree.AddAt(3, 100);
+			values[3] += 100;
+			tree.SetAt(9, -5);
+			values[9] = -5;
+			for (size_t left = 0; left < values.size(); ++left) {
+				for (size_t right = left; right < values.size(); ++right) {
+					Assert::AreEqual(
+						std::accumulate(values.begin() + left, values.begin() + right + 1, 0LL),
+						tree.RangeReduce(left, right));
+				}
+			}
+		}
+
+		TEST_METHOD(LayoutsAndParallelFillTest)
+		{
+			using namespace data_structures::interval_trees;
+			for (size_t size : { 1, 2, 257, 1000 }) {
+				std::vector<std::string> values(size);
+				for (size_t i = 0; i < size; ++i) {
+					values[i] = std::string(1, static_cast<char>('a' + i % 26));
+				}
+				auto concat = [](const std::string& a, const std::string& b) { return a + b; };
+				SimpleIntervalTree<std::string, false> power(size, concat, "");
+				SimpleIntervalTree<std::string, false> compact(size, concat, "", TreeLayout::Compact);
+				power.FillFrom(values);
+				compact.ParallelFillFrom(values, 3);
+				for (size_t left = 0; left < size; left += 1 + left / 4) {
+					for (size_t right = left; right < size; right += 1 + right / 3) {
+						const std::string expected = std::accumulate(
+							values.begin() + left, values.begin() + right + 1, std::string());
+						Assert::AreEqual(expected, power.RangeReduce(left, right));
+						Assert::AreEqual(expected, compact.RangeReduce(left, right));
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(BatchTest)
+		{
+			using namespace data_structures::interval_trees;
+			for (TreeLayout layout : { TreeLayout::PowerOfTwo, TreeLayout::Compact }) {
+				BasicIntervalTree<int, SumOp<int>> tree(100, 0, SumOp<int>(), layout);
+				std::vector<int> values(100, 0);
+				for (bool merge_ancestors : { false, true }) {
+					std::vector<std::pair<size_t, int>> updates;
+					for (size_t i = 0; i < 300; ++i) {
+						updates.emplace_back(i * 37 % 100, static_cast<int>(i));
+						values[i * 37 % 100] = static_cast<int>(i);
+					}
+					tree.BatchSetAt(updates, merge_ancestors);
+
+					std::vector<std::pair<size_t, size_t>> queries;
+					for (size_t left = 0; left < values.size(); left += 3) {
+						for (size_t right = left; right < values.size(); right += 7) {
+							queries.emplace_back(left, right);
+						}
+					}
+					const std::vector<int> results = tree.BatchRangeReduce(queries);
+					Assert::AreEqual(queries.size(), results.size());
+					for (size_t i = 0; i < queries.size(); ++i) {
+						Assert::AreEqual(
+							std::accumulate(values.begin() + queries[i].first, values.begin() + queries[i].second + 1, 0),
+							results[i]);
+					}
+				}
+			}
+		}
+
+
+		TEST_METHOD(MaxRightMinLeftTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::vector<int> values(300);
+			for (size_t i = 0; i < values.size(); ++i) {
+				values[i] = static_cast<int>(i * 7 % 11);
+			}
+			BasicIntervalTree<int, SumOp<int>> tree(values.size(), 0);
+			tree.FillFrom(values);
+			for (int limit : { 0, 5, 40, 1000, 100000 }) {
+				const auto fits = [limit](int sum) { return sum <= limit; };
+				for (size_t offset = 0; offset < values.size(); offset += 7) {
+					size_t right = offset;
+					for (int sum = 0; right < values.size() && sum + values[right] <= limit; ++right) {
+						sum += values[right];
+					}
+					Assert::AreEqual(right, tree.MaxRight(offset, fits));
+					size_t left = offset + 1;
+					for (int sum = 0; left > 0 && sum + values[left - 1] <= limit; --left) {
+						sum += values[left - 1];
+					}
+					Assert::AreEqual(left, tree.MinLeft(offset, fits));
+				}
+				Assert::AreEqual(values.size(), tree.MaxRight(values.size(), fits));
+			}
+		}
+
 	};
 }
\ No newline at end of file
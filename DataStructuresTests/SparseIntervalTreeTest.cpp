@@ -0,0 +1,67 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <CppUnitTest.h>
+#include "../DataStructures/SparseIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(SparseIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(HugeRangeTest)
+		{
+			using namespace data_structures::interval_trees;
+			const std::uint64_t size = std::uint64_t(1) << 40;
+			SparseIntervalTree<long long, SumOp<long long>> tree(size, 0);
+			std::map<std::uint64_t, long long> values;
+			std::mt19937_64 gen(1);
+			for (int step = 0; step < 1000; ++step) {
+				const std::uint64_t offset = gen() % size;
+				const long long value = static_cast<long long>(gen() % 100);
+				if (step % 2 == 0) {
+					tree.SetAt(offset, value);
+					values[offset] = value;
+				}
+				else {
+					tree.AddAt(offset, value);
+					values[offset] += value;
+				}
+			}
+			Assert::IsTrue(tree.node_count() < 1000 * 41);
+			for (int step = 0; step < 1000; ++step) {
+				std::uint64_t left = gen() % size;
+				std::uint64_t right = gen() % size;
+				if (left > right) std::swap(left, right);
+				long long expected = 0;
+				for (auto it = values.lower_bound(left); it != values.end() && it->first <= right; ++it) {
+					expected += it->second;
+				}
+				Assert::AreEqual(expected, tree.RangeReduce(left, right));
+			}
+			for (const auto& value : values) {
+				Assert::AreEqual(value.second, tree.At(value.first));
+			}
+		}
+
+		TEST_METHOD(KeepsOperandOrderTest)
+		{
+			using namespace data_structures::interval_trees;
+			auto concat = [](const std::string& a, const std::string& b) { return a + b; };
+			SparseIntervalTree<std::string, decltype(concat)> tree(1000000007, "", concat);
+			tree.SetAt(5, "a");
+			tree.SetAt(999999999, "c");
+			tree.SetAt(123456, "b");
+			tree.AddAt(5, "x", true);
+			tree.AddAt(5, "y");
+			Assert::AreEqual(std::string("xaybc"), tree.RangeReduce(0, 1000000006));
+			Assert::AreEqual(std::string("xay"), tree.At(5));
+			Assert::AreEqual(std::string("b"), tree.RangeReduce(6, 999999998));
+			Assert::AreEqual(std::string(), tree.RangeReduce(6, 100));
+		}
+
+	};
+}
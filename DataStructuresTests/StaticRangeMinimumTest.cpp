@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/StaticRangeMinimum.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(StaticRangeMinimumTests)
+	{
+	public:
+
+		TEST_METHOD(RandomQueriesTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (size_t size : { 1, 63, 64, 65, 1000, 5000 }) {
+				for (int range : { 3, 1000000 }) {
+					std::vector<int> values(size);
+					for (int& value : values) {
+						value = static_cast<int>(gen() % range);
+					}
+					StaticRangeMinimum<int> minimum(values);
+					std::vector<std::pair<size_t, size_t>> queries;
+					for (int step = 0; step < 500; ++step) {
+						size_t left = gen() % size;
+						size_t right = gen() % size;
+						if (left > right) std::swap(left, right);
+						queries.emplace_back(left, right);
+					}
+					const std::vector<int> results = minimum.BatchRangeReduce(queries);
+					for (size_t i = 0; i < queries.size(); ++i) {
+						const int expected = *std::min_element(
+							values.begin() + queries[i].first, values.begin() + queries[i].second + 1);
+						Assert::AreEqual(expected, minimum.RangeReduce(queries[i].first, queries[i].second));
+						Assert::AreEqual(expected, results[i]);
+					}
+				}
+			}
+		}
+
+	};
+}
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/WaveletMatrix.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(WaveletMatrixTests)
+	{
+	public:
+
+		TEST_METHOD(RandomQueriesTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (size_t size : { 1, 447, 448, 449, 3000 }) {
+				for (unsigned range : { 1u, 5u, 1000u, 4000000000u }) {
+					std::vector<unsigned> values(size);
+					for (auto& value : values) value = gen() % range;
+					WaveletMatrix<unsigned> matrix(values);
+					for (size_t i = 0; i < size; ++i) {
+						Assert::AreEqual(values[i], matrix.At(i));
+					}
+					for (int step = 0; step < 200; ++step) {
+						size_t left = gen() % size;
+						size_t right = gen() % size;
+						if (left > right) std::swap(left, right);
+						std::vector<unsigned> window(values.begin() + left, values.begin() + right + 1);
+						std::sort(window.begin(), window.end());
+						const size_t k = gen() % window.size();
+						Assert::AreEqual(window[k], matrix.RangeKthSmallest(left, right, k));
+						const unsigned value = step % 2 == 0 ? values[gen() % size] : gen() % range + 1;
+						const size_t less = std::lower_bound(window.begin(), window.end(), value) - window.begin();
+						const size_t equal = std::upper_bound(window.begin(), window.end(), value) - window.begin() - less;
+						Assert::AreEqual(less, matrix.RangeCountLess(left, right, value));
+						Assert::AreEqual(equal, matrix.RangeCount(left, right, value));
+					}
+				}
+			}
+		}
+
+		TEST_METHOD(SelectTest)
+		{
+			using namespace data_structures::interval_trees;
+			const std::vector<std::uint8_t> values{ 7, 255, 0, 7, 3, 7, 255 };
+			WaveletMatrix<std::uint8_t> matrix(values);
+			Assert::AreEqual(size_t(0), matrix.Select(7, 0));
+			Assert::AreEqual(size_t(3), matrix.Select(7, 1));
+			Assert::AreEqual(size_t(5), matrix.Select(7, 2));
+			Assert::AreEqual(values.size(), matrix.Select(7, 3));
+			Assert::AreEqual(size_t(6), matrix.Select(255, 1));
+			Assert::AreEqual(size_t(2), matrix.Select(0, 0));
+			Assert::AreEqual(values.size(), matrix.Select(1, 0));
+			Assert::AreEqual(size_t(5), matrix.RangeCountLess(0, 6, 255));
+		}
+
+	};
+}
@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include <CppUnitTest.h>
+#include "../DataStructures/WideIntervalTree.h"
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace DataStructuresTests
+{
+	TEST_CLASS(WideIntervalTreeTests)
+	{
+	public:
+
+		TEST_METHOD(MinAndSumTest)
+		{
+			using namespace data_structures::interval_trees;
+			std::mt19937 gen(1);
+			for (size_t size : { 1, 15, 16, 17, 256, 300, 5000 }) {
+				WideIntervalTree<int, MinOp<int>> minimum(size, 0);
+				WideIntervalTree<int, SumOp<int>> sum(size, 0);
+				std::vector<int> values(size);
+				for (int& value : values) {
+					value = static_cast<int>(gen() % 2001) - 1000;
+				}
+				minimum.FillFrom(values);
+				sum.FillFrom(values);
+				for (int step = 0; step < 2000; ++step) {
+					size_t left = gen() % size;
+					size_t right = gen() % size;
+					if (left > right) std::swap(left, right);
+					if (step % 4 == 0) {
+						values[left] = static_cast<int>(gen() % 2001) - 1000;
+						minimum.SetAt(left, values[left]);
+						sum.SetAt(left, values[left]);
+						continue;
+					}
+					Assert::AreEqual(
+						*std::min_element(values.begin() + left, values.begin() + right + 1),
+						minimum.RangeReduce(left, right));
+					Assert::AreEqual(
+						std::accumulate(values.begin() + left, values.begin() + right + 1, 0),
+						sum.RangeReduce(left, right));
+				}
+			}
+		}
+
+		TEST_METHOD(KeepsOperandOrderTest)
+		{
+			using namespace data_structures::interval_trees;
+			const size_t size = 700;
+			auto concat = [](const std::string& a, const std::string& b) { return a + b; };
+			WideIntervalTree<std::string, decltype(concat)> tree(size, "", concat);
+			std::vector<std::string> values(size);
+			for (size_t i = 0; i < size; ++i) {
+				values[i] = std::string(1, static_cast<char>('a' + i % 26));
+			}
+			tree.FillFrom(values);
+			tree.SetAt(300, "X");
+			values[300] = "X";
+			for (size_t left = 0; left < size; left += 13) {
+				for (size_t right = left; right < size; right += 29) {
+					Assert::AreEqual(
+						std::accumulate(values.begin() + left, values.begin() + right + 1, std::string()),
+						tree.RangeReduce(left, right));
+				}
+			}
+		}
+
+
+		TEST_METHOD(MaxRightMinLeftTest)
+		{
+			using namespace data_structures::interval_trees;
+			for (size_t size : { 1, 16, 256, 300, 4096 }) {
+				std::vector<int> values(size);
+				for (size_t i = 0; i < size; ++i) {
+					values[i] = static_cast<int>(i * 7 % 11);
+				}
+				WideIntervalTree<int, SumOp<int>> tree(size, 0);
+				tree.FillFrom(values);
+				for (int limit : { 0, 5, 40, 1000, 100000 }) {
+					const auto fits = [limit](int sum) { return sum <= limit; };
+					for (size_t offset = 0; offset < size; offset += 7) {
+						size_t right = offset;
+						for (int sum = 0; right < size && sum + values[right] <= limit; ++right) {
+							sum += values[right];
+						}
+						Assert::AreEqual(right, tree.MaxRight(offset, fits));
+						size_t left = offset + 1;
+						for (int sum = 0; left > 0 && sum + values[left - 1] <= limit; --left) {
+							sum += values[left - 1];
+						}
+						Assert::AreEqual(left, tree.MinLeft(offset, fits));
+					}
+				}
+			}
+		}
+
+	};
+}
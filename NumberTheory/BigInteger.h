@@ -34,12 +34,24 @@
 #include <cstddef>
 #include <cstdint>
 #include <limits>
+#include <new>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "BitOperations.h"
+#include "LimbKernels.h"
+
 /******************************************************************************
 * The stack allocator (classes Arena and ShortAlloc) is adapted from
 *       https://howardhinnant.github.io/short_alloc.h
@@ -72,6 +84,8 @@
 namespace number_theory {
 namespace big_integer {
 
+class LimbPoolScope;
+
 namespace detail
 {
 
@@ -80,8 +94,146 @@ constexpr std::size_t maxAlign() {
 	return alignof(max_align_t);
 }
 
+// Size-class free lists for the heap blocks that Arena falls back to.  Every
+// block carries a header with its size class, so it can be released on any
+// thread.  Blocks are only recycled while a LimbPoolScope is alive on the
+// releasing thread; otherwise they go straight back to ::operator delete.
+class LimbPool
+{
+public:
+	static constexpr std::size_t headerSize = maxAlign();
+	static constexpr std::size_t minClass = 5;      // 32 bytes.
+	static constexpr std::size_t maxClass = 16;     // 64 KiB.
+	static constexpr std::size_t maxCachedPerClass = 64;
+	static constexpr std::size_t unpooled = ~std::size_t(0);
+
+	LimbPool() noexcept : m_depth(0), m_systemAllocations(0), m_free(), m_cached() { }
+	LimbPool(const LimbPool&) = delete;
+	LimbPool& operator=(const LimbPool&) = delete;
+	~LimbPool() { release(); }
+
+	static LimbPool& local()
+	{
+		static thread_local LimbPool pool;
+		return pool;
+	}
+
+	static char* allocate(std::size_t n)
+	{
+		const std::size_t cls(sizeClass(n + headerSize));
+		LimbPool& pool(local());
+		char* block;
+
+		if (cls == unpooled)
+		{
+			block = pool.systemAllocate(n + headerSize);
+		}
+		else if (pool.m_depth && pool.m_free[cls - minClass])
+		{
+			FreeNode*& head(pool.m_free[cls - minClass]);
+			block = reinterpret_cast<char*>(head);
+			head = head->next;
+			--pool.m_cached[cls - minClass];
+		}
+		else
+		{
+			block = pool.systemAllocate(std::size_t(1) << cls);
+		}
+
+		*reinterpret_cast<std::size_t*>(block) = cls;
+		return block + headerSize;
+	}
+
+	static void deallocate(char* p) noexcept
+	{
+		char* block(p - headerSize);
+		const std::size_t cls(*reinterpret_cast<std::size_t*>(block));
+		LimbPool& pool(local());
+
+		if (cls != unpooled && pool.m_depth &&
+			pool.m_cached[cls - minClass] < maxCachedPerClass)
+		{
+			FreeNode*& head(pool.m_free[cls - minClass]);
+			head = new (block) FreeNode{ head };
+			++pool.m_cached[cls - minClass];
+		}
+		else
+		{
+			::operator delete(block);
+		}
+	}
+
+	// Number of blocks this thread has requested from ::operator new.
+	std::size_t systemAllocations() const noexcept { return m_systemAllocations; }
+
+	// Returns all cached blocks to ::operator delete.
+	void release() noexcept
+	{
+		for (std::size_t i(0); i <= maxClass - minClass; ++i)
+		{
+			while (FreeNode* node = m_free[i])
+			{
+				m_free[i] = node->next;
+				::operator delete(node);
+			}
+			m_cached[i] = 0;
+		}
+	}
+
+private:
+	friend class big_integer::LimbPoolScope;
+
+	struct FreeNode { FreeNode* next; };
+
+	static std::size_t sizeClass(std::size_t bytes) noexcept
+	{
+		std::size_t cls(minClass);
+		while ((std::size_t(1) << cls) < bytes)
+		{
+			if (++cls > maxClass) return unpooled;
+		}
+		return cls;
+	}
+
+	char* systemAllocate(std::size_t bytes)
+	{
+		++m_systemAllocations;
+		return static_cast<char*>(::operator new(bytes));
+	}
+
+	std::size_t m_depth;
+	std::size_t m_systemAllocations;
+	FreeNode* m_free[maxClass - minClass + 1];
+	std::size_t m_cached[maxClass - minClass + 1];
+};
+
 }
 
+// While at least one LimbPoolScope exists on a thread, heap blocks released
+// by BigUints on that thread are kept in per-size free lists and handed out
+// again, instead of going through malloc.  Wrap hot loops (factorization,
+// repeated divMod) in one:
+//
+//      {
+//          LimbPoolScope pool;
+//          for (...) { auto qr = n.divMod(d); ... }
+//      }
+//
+// Cached blocks are freed when the outermost scope on the thread ends.
+class LimbPoolScope
+{
+public:
+	LimbPoolScope() noexcept { ++detail::LimbPool::local().m_depth; }
+	LimbPoolScope(const LimbPoolScope&) = delete;
+	LimbPoolScope& operator=(const LimbPoolScope&) = delete;
+
+	~LimbPoolScope()
+	{
+		detail::LimbPool& pool(detail::LimbPool::local());
+		if (--pool.m_depth == 0) pool.release();
+	}
+};
+
 // Adapted from https://howardhinnant.github.io/stack_alloc.html
 template <std::size_t N, std::size_t A = detail::maxAlign()>
 class Arena
@@ -108,7 +260,7 @@ public:
 				A <= detail::maxAlign(),
 				"Operator new cannot guarantee the selected alignment");
 
-			return static_cast<char*>(::operator new(n));
+			return detail::LimbPool::allocate(n);
 		}
 	}
 
@@ -120,7 +272,7 @@ public:
 		}
 		else
 		{
-			::operator delete(p);
+			detail::LimbPool::deallocate(p);
 		}
 	}
 
@@ -188,15 +340,19 @@ public:
 		m_arena.deallocate(reinterpret_cast<char*>(p), n * sizeof(T));
 	}
 
-	template <class T1, std::size_t N1, class U, std::size_t M>
+	template <
+		class T1, std::size_t N1, std::size_t A1,
+		class U, std::size_t M, std::size_t A2>
 	friend bool operator==(
-		const ShortAlloc<T1, N1>& x,
-		const ShortAlloc<U, M>& y) noexcept;
+		const ShortAlloc<T1, N1, A1>& x,
+		const ShortAlloc<U, M, A2>& y) noexcept;
 
 private:
 	ArenaType& m_arena;
 };
 
+class BigUintView;
+
 class BigUint
 {
 public:
@@ -218,12 +374,27 @@ public:
 		, m_val(other.m_val, Alloc(m_arena))
 	{ }
 
+	// Leaves other equal to zero.  Heap-allocated limbs change owner without
+	// being copied.
+	BigUint(BigUint&& other) noexcept
+		: m_arena()
+		, m_val(Alloc(m_arena))
+	{
+		steal(other);
+	}
+
 	BigUint& operator=(const BigUint& other)
 	{
 		if (this != &other) m_val.assign(other.m_val.begin(), other.m_val.end());
 		return *this;
 	}
 
+	BigUint& operator=(BigUint&& other) noexcept
+	{
+		if (this != &other) steal(other);
+		return *this;
+	}
+
 	~BigUint() { }
 
 	// True if this object represents zero.
@@ -238,6 +409,18 @@ public:
 	std::string str() const;    // Get base-10 representation.
 	std::string bin() const;    // Get binary representation.
 
+	// Compact binary form: the number of limbs as a LEB128 varint, then the
+	// limbs, least significant first, as eight little-endian bytes each.  Zero
+	// has no limbs and takes a single byte.
+	std::size_t serializedSize() const;
+	unsigned char* serialize(unsigned char* out) const; // Returns the new end.
+	std::string serialize() const;
+
+	// Reads one value from [in, end) and advances in past it.  Throws
+	// std::invalid_argument for truncated or non-canonical input.
+	static BigUint deserialize(const unsigned char*& in, const unsigned char* end);
+	static BigUint deserialize(const std::string& bytes);
+
 								// Get as an unsigned long long.  Throws std::overflow_error if !trivial().
 	unsigned long long getSimple() const
 	{
@@ -265,12 +448,36 @@ public:
 	Data& data() { return m_val; }
 	const Data& data() const { return m_val; }
 
-	friend BigUint& operator*=(BigUint& lhs, const BigUint& rhs);
+	friend BigUint& operator*=(BigUint& lhs, BigUintView rhs);
 	friend BigUint operator<<(const BigUint&, Block);
+	friend BigUint operator>>(const BigUint&, Block);
+	friend BigUint& addmul(BigUint& acc, const BigUint& a, const BigUint& b);
 
+	// Index of the highest set bit, i.e. floor(log2(val)); 0 for zero.
 	static Block log2(const BigUint& val);
+
+	// Number of zero bits below the lowest set bit; 0 for zero.
+	static Block trailingZeros(const BigUint& val);
+
+	// Number of set bits.
+	static Block popCount(const BigUint& val);
+
+	// floor(sqrt(in)).
 	static BigUint sqrt(const BigUint& in);
 
+	// floor(in^(1/n)).  Throws std::invalid_argument if n is zero.
+	static BigUint nthRoot(const BigUint& in, Block n);
+
+	static BigUint pow(BigUint base, Block exponent);
+
+	// True if in == root^exponent for some root and exponent >= 2.  If so, the
+	// largest such exponent and its root are stored through the non-null
+	// out-parameters.
+	static bool perfectPower(
+		const BigUint& in,
+		BigUint* root = nullptr,
+		Block* exponent = nullptr);
+
 private:
 	enum InitialSize : size_t {};
 	explicit BigUint(InitialSize size)
@@ -286,14 +493,77 @@ private:
 	// ...without the copy overhead of performing the shift in advance.
 	void add(const BigUint& other, Block shift);
 
+	// Takes over the limbs of other and leaves it equal to zero.  Limbs that
+	// still live in the inline arena of other are copied instead.  Never
+	// allocates: a single copied limb fits in any buffer, and the zero put
+	// back into other fits in its now empty arena.
+	void steal(BigUint& other) noexcept;
+
 	Arena<N, A> m_arena;
 	Data m_val;
 };
 
+// Read-only view of a number whose limbs live elsewhere, e.g. in a memory
+// mapped file.  Nothing is copied, so the limbs must outlive the view; do not
+// bind one to a temporary BigUint.  Views compare, hash and multiply like the
+// BigUint they denote.
+class BigUintView
+{
+public:
+	using Block = BigUint::Block;
+
+	BigUintView() : m_begin(&zeroBlock()), m_size(1) { }
+
+	// Limbs are least significant first.  High zero limbs are ignored, and an
+	// empty range denotes zero.
+	BigUintView(const Block* begin, const Block* end)
+		: m_begin(begin)
+		, m_size(static_cast<std::size_t>(end - begin))
+	{
+		while (m_size > 1 && !m_begin[m_size - 1]) --m_size;
+		if (!m_size)
+		{
+			m_begin = &zeroBlock();
+			m_size = 1;
+		}
+	}
+
+	BigUintView(const BigUint& val)
+		: m_begin(val.data().data())
+		, m_size(val.blockSize())
+	{ }
+
+	bool zero() const { return trivial() && !m_begin[0]; }
+	bool trivial() const { return m_size == 1; }
+	std::size_t blockSize() const { return m_size; }
+
+	const Block* data() const { return m_begin; }
+	const Block* begin() const { return m_begin; }
+	const Block* end() const { return m_begin + m_size; }
+
+	// Copies the limbs into an owning BigUint.
+	BigUint value() const { return BigUint(begin(), end()); }
+
+	// Same format as BigUint::serialize.
+	std::size_t serializedSize() const;
+	unsigned char* serialize(unsigned char* out) const;
+
+private:
+	static const Block& zeroBlock()
+	{
+		static const Block zero(0);
+		return zero;
+	}
+
+	const Block* m_begin;
+	std::size_t m_size;
+};
+
 // Assignment.
 BigUint& operator+=(BigUint& lhs, const BigUint& rhs);
 BigUint& operator-=(BigUint& lhs, const BigUint& rhs);
 BigUint& operator*=(BigUint& lhs, const BigUint& rhs);
+BigUint& operator*=(BigUint& lhs, BigUintView rhs);
 BigUint& operator/=(BigUint& lhs, const BigUint& rhs);
 BigUint& operator%=(BigUint& lhs, const BigUint& rhs);
 
@@ -302,37 +572,124 @@ BigUint& operator|=(BigUint& lhs, const BigUint& rhs);
 BigUint& operator<<=(BigUint& lhs, BigUint::Block rhs);
 BigUint& operator>>=(BigUint& lhs, BigUint::Block rhs);
 
-// Copying.
+// Fused multiply-add and multiply-subtract.
+//      addmul(acc, a, b) is acc += a * b without materializing the product.
+//      submul(acc, a, b) is acc -= a * b, reusing the buffer of acc.
+BigUint& addmul(BigUint& acc, const BigUint& a, const BigUint& b);
+BigUint& submul(BigUint& acc, const BigUint& a, const BigUint& b);
+
+// Copying.  Overloads taking an rvalue operate on it in place, so chains like
+// a * b + c - d reuse the buffer of the first temporary.
 inline BigUint operator+(const BigUint& lhs, const BigUint& rhs)
 {
 	BigUint result(lhs); result += rhs; return result;
 }
 
+inline BigUint operator+(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs += rhs; return std::move(lhs);
+}
+
+inline BigUint operator+(const BigUint& lhs, BigUint&& rhs)
+{
+	rhs += lhs; return std::move(rhs);
+}
+
+inline BigUint operator+(BigUint&& lhs, BigUint&& rhs)
+{
+	lhs += rhs; return std::move(lhs);
+}
+
 inline BigUint operator-(const BigUint& lhs, const BigUint& rhs)
 {
 	BigUint result(lhs); result -= rhs; return result;
 }
 
+inline BigUint operator-(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs -= rhs; return std::move(lhs);
+}
+
 inline BigUint operator*(const BigUint& lhs, const BigUint& rhs)
 {
 	BigUint result(lhs); result *= rhs; return result;
 }
 
+inline BigUint operator*(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs *= rhs; return std::move(lhs);
+}
+
+inline BigUint operator*(const BigUint& lhs, BigUint&& rhs)
+{
+	rhs *= lhs; return std::move(rhs);
+}
+
+inline BigUint operator*(BigUint&& lhs, BigUint&& rhs)
+{
+	lhs *= rhs; return std::move(lhs);
+}
+
+inline BigUint operator*(const BigUintView lhs, const BigUintView rhs)
+{
+	BigUint result(lhs.value()); result *= rhs; return result;
+}
+
 inline BigUint operator/(const BigUint& lhs, const BigUint& rhs)
 {
 	BigUint result(lhs); result /= rhs; return result;
 }
 
+inline BigUint operator/(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs /= rhs; return std::move(lhs);
+}
+
 inline BigUint operator%(const BigUint& lhs, const BigUint& rhs)
 {
 	BigUint result(lhs); result %= rhs; return result;
 }
 
+inline BigUint operator%(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs %= rhs; return std::move(lhs);
+}
+
 inline BigUint operator|(const BigUint& lhs, const BigUint& rhs)
 {
 	BigUint result(lhs); result |= rhs; return result;
 }
 
+inline BigUint operator|(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs |= rhs; return std::move(lhs);
+}
+
+inline BigUint operator|(const BigUint& lhs, BigUint&& rhs)
+{
+	rhs |= lhs; return std::move(rhs);
+}
+
+inline BigUint operator|(BigUint&& lhs, BigUint&& rhs)
+{
+	lhs |= rhs; return std::move(lhs);
+}
+
+inline BigUint operator&(BigUint&& lhs, const BigUint& rhs)
+{
+	lhs &= rhs; return std::move(lhs);
+}
+
+inline BigUint operator<<(BigUint&& lhs, BigUint::Block rhs)
+{
+	lhs <<= rhs; return std::move(lhs);
+}
+
+inline BigUint operator>>(BigUint&& lhs, BigUint::Block rhs)
+{
+	lhs >>= rhs; return std::move(lhs);
+}
+
 BigUint operator&(const BigUint& lhs, const BigUint& rhs);
 BigUint operator<<(const BigUint& lhs, BigUint::Block rhs);
 BigUint operator >> (const BigUint& lhs, BigUint::Block rhs);
@@ -351,22 +708,39 @@ bool operator<=(const BigUint& lhs, const BigUint& rhs);
 bool operator> (const BigUint& lhs, const BigUint& rhs);
 bool operator>=(const BigUint& lhs, const BigUint& rhs);
 
+bool operator==(BigUintView lhs, BigUintView rhs);
+bool operator!=(BigUintView lhs, BigUintView rhs);
+bool operator< (BigUintView lhs, BigUintView rhs);
+bool operator<=(BigUintView lhs, BigUintView rhs);
+bool operator> (BigUintView lhs, BigUintView rhs);
+bool operator>=(BigUintView lhs, BigUintView rhs);
+
 inline bool operator!(const BigUint& val) { return val.zero(); }
 std::ostream& operator<<(std::ostream& out, const BigUint& val);
 std::istream& operator>>(std::istream& out, BigUint& val);
 
-template <class T, std::size_t N, class U, std::size_t M>
+// Allocators are interchangeable when they share an arena, or when neither
+// arena has a live stack allocation: then everything either of them handed out
+// came from ::operator new and may be released through the other one.  This is
+// what lets std::vector move heap buffers between two BigUints.
+template <
+	class T, std::size_t N, std::size_t A1,
+	class U, std::size_t M, std::size_t A2>
 inline bool operator==(
-	const ShortAlloc<T, N>& x,
-	const ShortAlloc<U, M>& y) noexcept
+	const ShortAlloc<T, N, A1>& x,
+	const ShortAlloc<U, M, A2>& y) noexcept
 {
-	return N == M && &x.m_arena == &y.m_arena;
+	return N == M && A1 == A2 && (
+		&x.m_arena == &y.m_arena ||
+		(x.m_arena.used() == 0 && y.m_arena.used() == 0));
 }
 
-template <class T, std::size_t N, class U, std::size_t M>
+template <
+	class T, std::size_t N, std::size_t A1,
+	class U, std::size_t M, std::size_t A2>
 inline bool operator!=(
-	const ShortAlloc<T, N>& x,
-	const ShortAlloc<U, M>& y) noexcept
+	const ShortAlloc<T, N, A1>& x,
+	const ShortAlloc<U, M, A2>& y) noexcept
 {
 	return !(x == y);
 }
@@ -445,7 +819,6 @@ inline void BigUint::add(const BigUint& rhs, const Block shift)
 	const Block shiftBack(shiftBits ? (bitsPerBlock - shiftBits) : 0);
 
 	const std::size_t rhsSize(rhsVal.size());
-	const std::size_t lhsSize(m_val.size());
 
 	bool carry(false);
 	Block rhsCur(0);
@@ -488,15 +861,35 @@ inline void BigUint::add(const BigUint& rhs, const Block shift)
 		}
 	}
 
-	while (carry && (shiftBlocks + i < lhsSize))
+	while (carry && (shiftBlocks + i < m_val.size()))
 	{
-		carry = (++m_val[i] == 0);
+		carry = (++m_val[shiftBlocks + i] == 0);
 		++i;
 	}
 
 	if (carry) m_val.push_back(1);
 }
 
+inline void BigUint::steal(BigUint& other) noexcept
+{
+	if (other.m_arena.used() != 0)
+	{
+		m_val.assign(other.m_val.begin(), other.m_val.end());
+		other.m_val.assign(1, 0);
+		return;
+	}
+
+	{
+		// Give our own buffer back first, so that m_arena is empty as well and
+		// the allocators compare equal.
+		Data released((Alloc(m_arena)));
+		released.swap(m_val);
+	}
+
+	m_val = std::move(other.m_val);
+	other.m_val.assign(1, 0);
+}
+
 inline std::pair<BigUint, BigUint> BigUint::divMod(const BigUint& d) const
 {
 	const auto& dVal(d.data());
@@ -566,28 +959,12 @@ inline BigUint& operator+=(BigUint& lhs, const BigUint& rhs)
 	else
 	{
 		const std::size_t rhsSize(rhsVal.size());
-		lhsVal.resize(std::max(lhsVal.size(), rhsSize), 0);
-		const std::size_t lhsSize(lhsVal.size());
-
-		bool carry(false);
-		std::size_t i(0);
-
-		while (i < rhsSize)
-		{
-			BigUint::Block& lhsCur(lhsVal[i]);
-			const BigUint::Block& rhsCur(rhsVal[i]);
-
-			lhsCur += rhsCur + static_cast<BigUint::Block>(carry);
-			carry = lhsCur < rhsCur || (carry && lhsCur == rhsCur);
+		if (lhsVal.size() < rhsSize) lhsVal.resize(rhsSize, 0);
 
-			++i;
-		}
-
-		while (carry && i < lhsSize)
-		{
-			carry = (++lhsVal[i] == 0);
-			++i;
-		}
+		BigUint::Block carry(
+			limb_kernels::AddLimbs(lhsVal.data(), rhsVal.data(), rhsSize));
+		carry = limb_kernels::PropagateCarry(
+			lhsVal.data() + rhsSize, lhsVal.size() - rhsSize, carry);
 
 		if (carry) lhsVal.push_back(1);
 	}
@@ -620,30 +997,18 @@ inline BigUint& operator-=(BigUint& lhs, const BigUint& rhs)
 		throw std::underflow_error(
 			"Subtraction result was negative (block size)");
 	}
+	else if (lhsSize == rhsSize && lhs < rhs)
+	{
+		// Checked up front so that lhs is left untouched.
+		throw std::underflow_error(
+			"Subtraction result was negative (magnitude)");
+	}
 	else
 	{
-		BigUint::Block old(0);
-		bool borrow(false);
-		std::size_t i(0);
-
-		while (i < rhsSize)
-		{
-			BigUint::Block& lhsCur(lhsVal[i]);
-			old = lhsCur;
-			const BigUint::Block& rhsCur(rhsVal[i]);
-
-			lhsCur -= rhsCur + static_cast<BigUint::Block>(borrow);
-			borrow = lhsCur > old || (borrow && lhsCur == old);
-
-			++i;
-		}
-
-		while (borrow && i < lhsSize)
-		{
-			borrow = (lhsVal[i] == 0);
-			--lhsVal[i];
-			++i;
-		}
+		BigUint::Block borrow(
+			limb_kernels::SubLimbs(lhsVal.data(), rhsVal.data(), rhsSize));
+		borrow = limb_kernels::PropagateBorrow(
+			lhsVal.data() + rhsSize, lhsSize - rhsSize, borrow);
 
 		if (borrow)
 		{
@@ -658,50 +1023,89 @@ inline BigUint& operator-=(BigUint& lhs, const BigUint& rhs)
 }
 
 inline BigUint& operator*=(BigUint& lhs, const BigUint& rhs)
+{
+	return lhs *= BigUintView(rhs);
+}
+
+inline BigUint& operator*=(BigUint& lhs, const BigUintView rhs)
 {
 	if (lhs.zero() || rhs.zero())
 	{
 		lhs = 0;
 	}
 	else if (
-		BigUint::log2(lhs) + BigUint::log2(rhs) + 1 <=
-		BigUint::bitsPerBlock)
+		lhs.trivial() && rhs.trivial() &&
+		bit_operations::BitLength(lhs.data().front()) +
+		bit_operations::BitLength(rhs.data()[0]) <= BigUint::bitsPerBlock)
 	{
-		lhs = lhs.data().front() * rhs.data().front();
+		lhs = lhs.data().front() * rhs.data()[0];
 	}
 	else
 	{
 		BigUint out;
-		auto& rhsVal(rhs.data());
+		const BigUint::Block* rhsVal(rhs.data());
 
-		for (std::size_t block(0); block < rhsVal.size(); ++block)
+		for (std::size_t block(0); block < rhs.blockSize(); ++block)
 		{
 			for (std::size_t bit(0); bit < BigUint::bitsPerBlock; ++bit)
 			{
-				if ((rhsVal.at(block) >> bit) & 1)
+				if ((rhsVal[block] >> bit) & 1)
 				{
 					out.add(lhs, block * BigUint::bitsPerBlock + bit);
 				}
 			}
 		}
 
-		lhs = out;
+		lhs = std::move(out);
 	}
 
 	return lhs;
 }
 
+inline BigUint& addmul(BigUint& acc, const BigUint& a, const BigUint& b)
+{
+	if (&acc == &a || &acc == &b)
+	{
+		acc += a * b;
+	}
+	else if (!a.zero() && !b.zero())
+	{
+		// Walk the bits of the shorter factor.
+		const BigUint& shifted(a.blockSize() < b.blockSize() ? b : a);
+		const auto& bitsVal((&shifted == &a ? b : a).data());
+
+		for (std::size_t block(0); block < bitsVal.size(); ++block)
+		{
+			for (std::size_t bit(0); bit < BigUint::bitsPerBlock; ++bit)
+			{
+				if ((bitsVal[block] >> bit) & 1)
+				{
+					acc.add(shifted, block * BigUint::bitsPerBlock + bit);
+				}
+			}
+		}
+	}
+
+	return acc;
+}
+
+inline BigUint& submul(BigUint& acc, const BigUint& a, const BigUint& b)
+{
+	acc -= a * b;
+	return acc;
+}
+
 inline BigUint& operator/=(BigUint& n, const BigUint& d)
 {
-	const auto div(n.divMod(d));
-	n = div.first;
+	auto div(n.divMod(d));
+	n = std::move(div.first);
 	return n;
 }
 
 inline BigUint& operator%=(BigUint& n, const BigUint& d)
 {
-	const auto div(n.divMod(d));
-	n = div.second;
+	auto div(n.divMod(d));
+	n = std::move(div.second);
 	return n;
 }
 
@@ -711,11 +1115,7 @@ inline BigUint& operator&=(BigUint& lhs, const BigUint& rhs)
 	auto& rhsVal(rhs.data());
 
 	lhsVal.resize(std::min(lhsVal.size(), rhsVal.size()));
-
-	for (std::size_t i(0); i < lhsVal.size(); ++i)
-	{
-		lhsVal[i] &= rhsVal[i];
-	}
+	limb_kernels::AndLimbs(lhsVal.data(), rhsVal.data(), lhsVal.size());
 
 	while (!lhs.zero() && !lhsVal.back()) lhsVal.pop_back();
 
@@ -730,22 +1130,19 @@ inline BigUint& operator|=(BigUint& lhs, const BigUint& rhs)
 	const std::size_t rhsSize(rhsVal.size());
 
 	lhsVal.resize(std::max(lhsVal.size(), rhsSize), 0);
-
-	for (std::size_t i(0); i < rhsSize; ++i)
-	{
-		lhsVal[i] |= rhsVal[i];
-	}
+	limb_kernels::OrLimbs(lhsVal.data(), rhsVal.data(), rhsSize);
 
 	return lhs;
 }
 
 inline BigUint& operator<<=(BigUint& lhs, BigUint::Block rhs)
 {
+	if (lhs.zero() || !rhs) return lhs;
+
 	if (
-		lhs.zero() || !rhs ||
-		(lhs.trivial() && rhs < BigUint::bitsPerBlock &&
+		lhs.trivial() && rhs < BigUint::bitsPerBlock &&
 		(lhs.data().front() &
-			(BigUint::blockMax << (BigUint::bitsPerBlock - rhs))) == 0))
+			(BigUint::blockMax << (BigUint::bitsPerBlock - rhs))) == 0)
 	{
 		lhs.data().front() <<= rhs;
 		return lhs;
@@ -753,30 +1150,26 @@ inline BigUint& operator<<=(BigUint& lhs, BigUint::Block rhs)
 
 	const std::size_t startBlocks(lhs.blockSize());
 	const std::size_t shiftBlocks = std::size_t(rhs / BigUint::bitsPerBlock);
-	const std::size_t shiftBits(rhs % BigUint::bitsPerBlock);
-	const std::size_t shiftBack(
-		shiftBits ? (BigUint::bitsPerBlock - shiftBits) : 0);
+	const unsigned shiftBits(unsigned(rhs % BigUint::bitsPerBlock));
 
 	auto& val(lhs.data());
 
-	{
-		BigUint::Block carry(shiftBack ? val.back() >> shiftBack : 0);
-		val.resize(startBlocks + shiftBlocks + (carry ? 1 : 0), 0);
-		if (carry) val.back() = carry;
-	}
+	val.resize(startBlocks + shiftBlocks, 0);
 
-	for (std::size_t i(startBlocks - 1); i < startBlocks; --i)
+	if (shiftBits)
 	{
-		val[i + shiftBlocks] =
-			(shiftBack && i ? val[i - 1] >> shiftBack : 0) |
-			(val[i] << shiftBits);
+		const BigUint::Block carry(limb_kernels::ShiftLeftLimbs(
+			val.data() + shiftBlocks, val.data(), startBlocks, shiftBits));
+		if (carry) val.push_back(carry);
 	}
-
-	for (std::size_t i(0); i < shiftBlocks; ++i)
+	else
 	{
-		val[i] = 0;
+		std::copy_backward(
+			val.begin(), val.begin() + startBlocks, val.begin() + startBlocks + shiftBlocks);
 	}
 
+	std::fill(val.begin(), val.begin() + shiftBlocks, 0);
+
 	return lhs;
 }
 
@@ -784,24 +1177,30 @@ inline BigUint& operator>>=(BigUint& lhs, BigUint::Block rhs)
 {
 	const std::size_t startBlocks(lhs.blockSize());
 	const std::size_t shiftBlocks = std::size_t(rhs / BigUint::bitsPerBlock);
-	const std::size_t shiftBits(rhs % BigUint::bitsPerBlock);
-	const std::size_t shiftBack(
-		shiftBits ? (BigUint::bitsPerBlock - shiftBits) : 0);
+	const unsigned shiftBits(unsigned(rhs % BigUint::bitsPerBlock));
 
 	auto& val(lhs.data());
 
-	for (std::size_t i(shiftBlocks); i < startBlocks - 1; ++i)
+	if (shiftBlocks >= startBlocks)
 	{
-		val[i - shiftBlocks] =
-			(shiftBack ? val[i + 1] << shiftBack : 0) |
-			(val[i] >> shiftBits);
+		val.assign(1, 0);
+		return lhs;
 	}
 
-	BigUint::Block last(val.back() >> shiftBits);
-	val.resize(startBlocks - shiftBlocks - (last ? 0 : 1));
+	const std::size_t endBlocks(startBlocks - shiftBlocks);
+
+	if (shiftBits)
+	{
+		limb_kernels::ShiftRightLimbs(
+			val.data(), val.data() + shiftBlocks, endBlocks, shiftBits);
+	}
+	else
+	{
+		std::copy(val.begin() + shiftBlocks, val.end(), val.begin());
+	}
 
-	if (val.empty()) val.push_back(0);
-	else if (last) val.back() = last;
+	val.resize(endBlocks);
+	while (val.size() != 1 && val.back() == 0) val.pop_back();
 
 	return lhs;
 }
@@ -824,45 +1223,64 @@ inline BigUint operator&(const BigUint& lhs, const BigUint& rhs)
 
 inline BigUint operator<<(const BigUint& lhs, const BigUint::Block rhs)
 {
+	if (lhs.zero() || !rhs) return lhs;
+
 	if (
-		lhs.zero() || !rhs ||
-		(lhs.trivial() && rhs < BigUint::bitsPerBlock &&
+		lhs.trivial() && rhs < BigUint::bitsPerBlock &&
 		(lhs.data().front() &
-			(BigUint::blockMax << (BigUint::bitsPerBlock - rhs))) == 0))
+			(BigUint::blockMax << (BigUint::bitsPerBlock - rhs))) == 0)
 	{
 		return BigUint(lhs.data().front() << rhs);
 	}
 
 	const std::size_t startBlocks(lhs.blockSize());
 	const std::size_t shiftBlocks = std::size_t(rhs / BigUint::bitsPerBlock);
-	const std::size_t shiftBits(rhs % BigUint::bitsPerBlock);
+	const unsigned shiftBits(unsigned(rhs % BigUint::bitsPerBlock));
 
 	BigUint result(BigUint::InitialSize(startBlocks + shiftBlocks));
 
 	const auto& start(lhs.data());
 	auto& val(result.data());
 
-	BigUint::Block carry(0);
-
-	for (std::size_t i(0); i < startBlocks; ++i)
+	if (shiftBits)
 	{
-		val[i + shiftBlocks] = (start[i] << shiftBits) | carry;
-		carry = shiftBits ?
-			(start[i] >> (BigUint::bitsPerBlock - shiftBits)) : 0;
+		const BigUint::Block carry(limb_kernels::ShiftLeftLimbs(
+			val.data() + shiftBlocks, start.data(), startBlocks, shiftBits));
+		if (carry) val.push_back(carry);
+	}
+	else
+	{
+		std::copy(start.begin(), start.end(), val.begin() + shiftBlocks);
 	}
-
-	if (carry) val.push_back(carry);
-
-	while (val.size() != 1 && val.back() == 0) val.pop_back();
 
 	return result;
 }
 
 inline BigUint operator >> (const BigUint& lhs, const BigUint::Block rhs)
 {
-	// TODO Can be optimized like the above.
-	BigUint result(lhs);
-	result >>= rhs;
+	const std::size_t startBlocks(lhs.blockSize());
+	const std::size_t shiftBlocks = std::size_t(rhs / BigUint::bitsPerBlock);
+	const unsigned shiftBits(unsigned(rhs % BigUint::bitsPerBlock));
+
+	if (shiftBlocks >= startBlocks) return BigUint(0);
+
+	BigUint result(BigUint::InitialSize(startBlocks - shiftBlocks));
+
+	const auto& start(lhs.data());
+	auto& val(result.data());
+
+	if (shiftBits)
+	{
+		limb_kernels::ShiftRightLimbs(
+			val.data(), start.data() + shiftBlocks, val.size(), shiftBits);
+	}
+	else
+	{
+		std::copy(start.begin() + shiftBlocks, start.end(), val.begin());
+	}
+
+	while (val.size() != 1 && val.back() == 0) val.pop_back();
+
 	return result;
 }
 
@@ -897,16 +1315,9 @@ inline bool operator==(const BigUint& lhs, const BigUint& rhs)
 	const auto& lhsVal(lhs.data());
 	const auto& rhsVal(rhs.data());
 
-	const std::size_t size(lhsVal.size());
-
-	if (size != rhsVal.size()) return false;
-
-	for (std::size_t i(0); i < size; ++i)
-	{
-		if (lhsVal[i] != rhsVal[i]) return false;
-	}
-
-	return true;
+	return
+		lhsVal.size() == rhsVal.size() &&
+		std::equal(lhsVal.begin(), lhsVal.end(), rhsVal.begin());
 }
 
 inline bool operator!=(const BigUint& lhs, const BigUint& rhs)
@@ -930,16 +1341,7 @@ inline bool operator<(const BigUint& lhs, const BigUint& rhs)
 
 	if (lhsSize < rhsSize) return true;
 	else if (lhsSize > rhsSize) return false;
-	else
-	{
-		for (std::size_t i(lhsSize - 1); i < lhsSize; --i)
-		{
-			if (lhsVal[i] < rhsVal[i]) return true;
-			else if (lhsVal[i] > rhsVal[i]) return false;
-		}
-
-		return false;
-	}
+	else return limb_kernels::CompareLimbs(lhsVal.data(), rhsVal.data(), lhsSize) < 0;
 }
 
 inline bool operator<=(const BigUint& lhs, const BigUint& rhs)
@@ -971,62 +1373,1147 @@ inline std::istream& operator>>(std::istream& in, BigUint& val)
 	return in;
 }
 
+inline bool operator==(const BigUintView lhs, const BigUintView rhs)
+{
+	return
+		lhs.blockSize() == rhs.blockSize() &&
+		std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+inline bool operator!=(const BigUintView lhs, const BigUintView rhs)
+{
+	return !(lhs == rhs);
+}
+
+inline bool operator<(const BigUintView lhs, const BigUintView rhs)
+{
+	if (lhs.blockSize() != rhs.blockSize()) return lhs.blockSize() < rhs.blockSize();
+	return limb_kernels::CompareLimbs(lhs.data(), rhs.data(), lhs.blockSize()) < 0;
+}
+
+inline bool operator<=(const BigUintView lhs, const BigUintView rhs)
+{
+	return !(rhs < lhs);
+}
+
+inline bool operator>(const BigUintView lhs, const BigUintView rhs)
+{
+	return rhs < lhs;
+}
+
+inline bool operator>=(const BigUintView lhs, const BigUintView rhs)
+{
+	return !(lhs < rhs);
+}
+
+inline std::size_t BigUintView::serializedSize() const
+{
+	const std::size_t limbs(zero() ? 0 : m_size);
+
+	std::size_t size(1);
+	for (std::size_t rest(limbs >> 7); rest; rest >>= 7) ++size;
+
+	return size + limbs * sizeof(Block);
+}
+
+inline unsigned char* BigUintView::serialize(unsigned char* out) const
+{
+	const std::size_t limbs(zero() ? 0 : m_size);
+
+	std::size_t rest(limbs);
+	for (; rest >= 0x80; rest >>= 7)
+	{
+		*out++ = static_cast<unsigned char>(rest | 0x80);
+	}
+	*out++ = static_cast<unsigned char>(rest);
+
+	for (std::size_t i(0); i < limbs; ++i)
+	{
+		const Block limb(m_begin[i]);
+		for (std::size_t byte(0); byte < sizeof(Block); ++byte)
+		{
+			*out++ = static_cast<unsigned char>(limb >> (byte * CHAR_BIT));
+		}
+	}
+
+	return out;
+}
+
+inline std::size_t BigUint::serializedSize() const
+{
+	return BigUintView(*this).serializedSize();
+}
+
+inline unsigned char* BigUint::serialize(unsigned char* out) const
+{
+	return BigUintView(*this).serialize(out);
+}
+
+inline std::string BigUint::serialize() const
+{
+	std::string bytes(serializedSize(), '\0');
+	serialize(reinterpret_cast<unsigned char*>(&bytes[0]));
+	return bytes;
+}
+
+inline BigUint BigUint::deserialize(
+	const unsigned char*& in,
+	const unsigned char* const end)
+{
+	const unsigned char* cur(in);
+
+	std::size_t limbs(0);
+	for (unsigned shift(0); ; shift += 7)
+	{
+		if (cur == end) throw std::invalid_argument("Truncated BigUint length.");
+
+		const std::size_t bits(*cur & 0x7f);
+		if (shift >= std::numeric_limits<std::size_t>::digits ||
+			((bits << shift) >> shift) != bits ||
+			(shift && !*cur))
+		{
+			throw std::invalid_argument("Malformed BigUint length.");
+		}
+
+		limbs |= bits << shift;
+		if (!(*cur++ & 0x80)) break;
+	}
+
+	if (limbs > static_cast<std::size_t>(end - cur) / sizeof(Block))
+	{
+		throw std::invalid_argument("Truncated BigUint limbs.");
+	}
+
+	BigUint result((InitialSize(limbs)));
+	for (std::size_t i(0); i < limbs; ++i)
+	{
+		Block limb(0);
+		for (std::size_t byte(0); byte < sizeof(Block); ++byte)
+		{
+			limb |= static_cast<Block>(*cur++) << (byte * CHAR_BIT);
+		}
+		result.m_val[i] = limb;
+	}
+
+	if (limbs && !result.m_val.back())
+	{
+		throw std::invalid_argument("Non-canonical BigUint: high limb is zero.");
+	}
+
+	in = cur;
+	return result;
+}
+
+inline BigUint BigUint::deserialize(const std::string& bytes)
+{
+	const unsigned char* in(reinterpret_cast<const unsigned char*>(bytes.data()));
+	const unsigned char* const end(in + bytes.size());
+
+	BigUint result(deserialize(in, end));
+	if (in != end) throw std::invalid_argument("Trailing bytes after BigUint.");
+
+	return result;
+}
+
 inline BigUint::Block BigUint::log2(const BigUint& in)
 {
-	if (in.trivial()) return Block(std::log2(in.getSimple()));
+	if (in.zero()) return 0;
 	return
-		Block(std::log2(in.data().back())) +
-		(in.blockSize() - 1) * BigUint::bitsPerBlock;
+		(in.blockSize() - 1) * bitsPerBlock +
+		bit_operations::BitLength(in.data().back()) - 1;
+}
+
+inline BigUint::Block BigUint::trailingZeros(const BigUint& in)
+{
+	if (in.zero()) return 0;
+
+	const auto& val(in.data());
+	std::size_t block(0);
+	while (!val[block]) ++block;
+
+	return block * bitsPerBlock + bit_operations::CountTrailingZeros(val[block]);
+}
+
+inline BigUint::Block BigUint::popCount(const BigUint& in)
+{
+	Block result(0);
+	for (const Block block : in.data()) result += bit_operations::PopCount(block);
+	return result;
 }
 
 inline BigUint BigUint::sqrt(const BigUint& in)
 {
-	return BigUint(1) << (log2(in) / 2);
+	if (in.trivial()) return BigUint(bit_operations::IntegerSqrt(in.getSimple()));
+
+	// With top = in >> shift for an even shift, in < (top + 1) << shift, so
+	// the estimate below is never smaller than the root and is within about
+	// 2^-31 of it.  Newton's iteration then decreases monotonically.
+	const Block bits(log2(in) + 1);
+	const Block shift((bits - bitsPerBlock + 1) & ~Block(1));
+	const Block top((in >> shift).getSimple());
+
+	BigUint x(BigUint(bit_operations::IntegerSqrt(top) + 1) << (shift / 2));
+
+	for (;;)
+	{
+		BigUint y((x + in / x) >> 1);
+		if (!(y < x)) return x;
+		x = std::move(y);
+	}
 }
 
-} // namespace big_integer
-} // namespace number_theory
+inline BigUint BigUint::pow(BigUint base, Block exponent)
+{
+	BigUint result(1);
 
-namespace std
+	while (exponent)
+	{
+		if (exponent & 1) result *= base;
+		exponent >>= 1;
+		if (exponent) base *= base;
+	}
+
+	return result;
+}
+
+inline BigUint BigUint::nthRoot(const BigUint& in, const Block n)
+{
+	if (!n) throw std::invalid_argument("Zeroth root is undefined");
+	if (n == 1 || in < 2) return in;
+	if (n == 2) return sqrt(in);
+
+	const Block bits(log2(in) + 1);
+	if (n >= bits) return 1;
+
+	// Estimate log2 of the root from the top bits in floating point.  The
+	// 1e-9 margin is far above the rounding error, so the estimate is never
+	// below the root, while still being close enough for Newton's iteration
+	// to converge quadratically from the first step.
+	const Block shift(bits > bitsPerBlock ? bits - bitsPerBlock : 0);
+	const double rootLog2(
+		(static_cast<double>(shift) +
+			std::log2(static_cast<double>((in >> shift).getSimple()))) /
+		static_cast<double>(n) + 1e-9);
+	const Block whole(static_cast<Block>(rootLog2));
+
+	BigUint x(whole < 52 ?
+		BigUint(static_cast<Block>(std::exp2(rootLog2)) + 1) :
+		BigUint(static_cast<Block>(std::exp2(rootLog2 - whole + 52)) + 1) << (whole - 52));
+
+	for (;;)
+	{
+		BigUint y(x * (n - 1));
+		y += in / pow(x, n - 1);
+		y /= n;
+		if (!(y < x)) return x;
+		x = std::move(y);
+	}
+}
+
+namespace detail
 {
 
-template<> struct hash<number_theory::big_integer::BigUint>
+inline bool isSmallPrime(BigUint::Block n)
 {
-	using BigUint = number_theory::big_integer::BigUint;
-	// Based on the public domain Murmur hash, by Austin Appleby.
-	// https://sites.google.com/site/murmurhash/
-	std::size_t operator()(const BigUint& big) const
+	if (n < 2) return false;
+	for (BigUint::Block d(2); d * d <= n; ++d)
+	{
+		if (n % d == 0) return false;
+	}
+	return true;
+}
+
+// val % m for m < 2^32, one half-block at a time.
+inline BigUint::Block modSmall(const BigUint& val, BigUint::Block m)
+{
+	const auto& data(val.data());
+	BigUint::Block r(0);
+
+	for (std::size_t i(data.size() - 1); i < data.size(); --i)
+	{
+		r = ((r << 32) | (data[i] >> 32)) % m;
+		r = ((r << 32) | (data[i] & 0xffffffffULL)) % m;
+	}
+
+	return r;
+}
+
+// base^e % m for m < 2^32.
+inline BigUint::Block powSmall(BigUint::Block base, BigUint::Block e, BigUint::Block m)
+{
+	BigUint::Block result(1 % m);
+	base %= m;
+
+	while (e)
+	{
+		if (e & 1) result = result * base % m;
+		base = base * base % m;
+		e >>= 1;
+	}
+
+	return result;
+}
+
+}
+
+inline bool BigUint::perfectPower(const BigUint& in, BigUint* root, Block* exponent)
+{
+	if (in < 4) return false;
+
+	BigUint base(in);
+	Block total(1);
+
+	// A perfect k-th power is also a perfect p-th power for every prime p
+	// dividing k, so it suffices to peel off prime exponents one by one.
+	for (Block p(2); p <= log2(base); )
+	{
+		// Cheap necessary conditions before the expensive root: the exponent
+		// divides the number of trailing zeros, and modulo a prime q = kp + 1
+		// a p-th power is either zero or a k-th root of unity.
+		const Block zeros(trailingZeros(base));
+		bool possible(!zeros || zeros % p == 0);
+
+		for (Block k(2), tested(0); possible && tested < 3; k += 2)
+		{
+			const Block q(k * p + 1);
+			if (q >> 32) break;
+			if (!detail::isSmallPrime(q)) continue;
+
+			const Block r(detail::modSmall(base, q));
+			possible = !r || detail::powSmall(r, k, q) == 1;
+			++tested;
+		}
+
+		if (possible)
+		{
+			BigUint candidate(nthRoot(base, p));
+			if (pow(candidate, p) == base)
+			{
+				base = std::move(candidate);
+				total *= p;
+				continue;
+			}
+		}
+
+		while (!detail::isSmallPrime(++p)) { }
+	}
+
+	if (total == 1) return false;
+	if (root) *root = std::move(base);
+	if (exponent) *exponent = total;
+	return true;
+}
+
+// Binary (Stein's) GCD: only shifts and subtractions, which are much cheaper
+// than the bit-serial divMod that Euclid's algorithm would need.
+inline BigUint gcd(BigUint a, BigUint b)
+{
+	if (a.zero()) return b;
+	if (b.zero()) return a;
+
+	const BigUint::Block aShift(BigUint::trailingZeros(a));
+	const BigUint::Block bShift(BigUint::trailingZeros(b));
+	a >>= aShift;
+
+	do
+	{
+		b >>= BigUint::trailingZeros(b);
+		if (b < a) std::swap(a, b);
+		b -= a;
+	} while (!b.zero());
+
+	a <<= std::min(aShift, bShift);
+	return a;
+}
+
+// Signed integer in sign-magnitude form.  Zero is never negative.
+//
+// Division truncates toward zero and the remainder takes the sign of the
+// dividend, like the built-in integer types.
+class BigInt
+{
+public:
+	BigInt() : m_mag(), m_negative(false) { }
+
+	template<typename T, class = typename std::enable_if<std::is_integral<T>::value>::type>
+	BigInt(T val)
+		: m_mag(val < T(0) ? BigUint::Block(0) - BigUint::Block(val) : BigUint::Block(val))
+		, m_negative(val < T(0))
+	{ }
+
+	BigInt(const BigUint& mag, bool negative = false)
+		: m_mag(mag)
+		, m_negative(negative && !mag.zero())
+	{ }
+
+	BigInt(BigUint&& mag, bool negative = false)
+		: m_mag(std::move(mag))
+		, m_negative(negative && !m_mag.zero())
+	{ }
+
+	// Accepts an optional leading '-' or '+'.
+	explicit BigInt(const std::string& val)
+		: m_mag(!val.empty() && (val[0] == '-' || val[0] == '+') ? BigUint(val.substr(1)) : BigUint(val))
+		, m_negative(!val.empty() && val[0] == '-' && !m_mag.zero())
+	{ }
+
+	bool zero() const { return m_mag.zero(); }
+	bool negative() const { return m_negative; }
+	explicit operator bool() const { return !zero(); }
+
+	const BigUint& magnitude() const { return m_mag; }
+
+	std::string str() const { return m_negative ? "-" + m_mag.str() : m_mag.str(); }
+
+	// Return value:
+	//      result.first - quotient, rounded toward zero
+	//      result.second - remainder, with the sign of *this
+	std::pair<BigInt, BigInt> divMod(const BigInt& denominator) const
+	{
+		auto div(m_mag.divMod(denominator.m_mag));
+		return std::make_pair(
+			BigInt(std::move(div.first), m_negative != denominator.m_negative),
+			BigInt(std::move(div.second), m_negative));
+	}
+
+	friend BigInt operator-(BigInt val)
+	{
+		val.m_negative = !val.m_negative && !val.zero();
+		return val;
+	}
+
+	friend BigInt& operator+=(BigInt& lhs, const BigInt& rhs)
+	{
+		lhs.accumulate(rhs.m_mag, rhs.m_negative);
+		return lhs;
+	}
+
+	friend BigInt& operator-=(BigInt& lhs, const BigInt& rhs)
+	{
+		lhs.accumulate(rhs.m_mag, !rhs.m_negative);
+		return lhs;
+	}
+
+	friend BigInt& operator*=(BigInt& lhs, const BigInt& rhs)
+	{
+		lhs.m_mag *= rhs.m_mag;
+		lhs.m_negative = lhs.m_negative != rhs.m_negative && !lhs.m_mag.zero();
+		return lhs;
+	}
+
+	friend BigInt& operator/=(BigInt& lhs, const BigInt& rhs)
+	{
+		const bool negative(lhs.m_negative != rhs.m_negative);
+		lhs.m_mag /= rhs.m_mag;
+		lhs.m_negative = negative && !lhs.m_mag.zero();
+		return lhs;
+	}
+
+	friend BigInt& operator%=(BigInt& lhs, const BigInt& rhs)
+	{
+		lhs.m_mag %= rhs.m_mag;
+		lhs.m_negative = lhs.m_negative && !lhs.m_mag.zero();
+		return lhs;
+	}
+
+	friend bool operator==(const BigInt& lhs, const BigInt& rhs)
+	{
+		return lhs.m_negative == rhs.m_negative && lhs.m_mag == rhs.m_mag;
+	}
+
+	friend bool operator<(const BigInt& lhs, const BigInt& rhs)
+	{
+		if (lhs.m_negative != rhs.m_negative) return lhs.m_negative;
+		return lhs.m_negative ? rhs.m_mag < lhs.m_mag : lhs.m_mag < rhs.m_mag;
+	}
+
+private:
+	// *this += (negative ? -mag : mag)
+	void accumulate(const BigUint& mag, bool negative)
+	{
+		if (m_negative == negative)
+		{
+			m_mag += mag;
+		}
+		else if (mag <= m_mag)
+		{
+			m_mag -= mag;
+			m_negative = m_negative && !m_mag.zero();
+		}
+		else
+		{
+			m_mag = mag - m_mag;
+			m_negative = negative;
+		}
+	}
+
+	BigUint m_mag;
+	bool m_negative;
+};
+
+inline BigInt operator+(BigInt lhs, const BigInt& rhs) { lhs += rhs; return lhs; }
+inline BigInt operator-(BigInt lhs, const BigInt& rhs) { lhs -= rhs; return lhs; }
+inline BigInt operator*(BigInt lhs, const BigInt& rhs) { lhs *= rhs; return lhs; }
+inline BigInt operator/(BigInt lhs, const BigInt& rhs) { lhs /= rhs; return lhs; }
+inline BigInt operator%(BigInt lhs, const BigInt& rhs) { lhs %= rhs; return lhs; }
+
+inline BigInt abs(BigInt val) { return val.negative() ? -std::move(val) : val; }
+
+inline bool operator!=(const BigInt& lhs, const BigInt& rhs) { return !(lhs == rhs); }
+inline bool operator<=(const BigInt& lhs, const BigInt& rhs) { return !(rhs < lhs); }
+inline bool operator> (const BigInt& lhs, const BigInt& rhs) { return rhs < lhs; }
+inline bool operator>=(const BigInt& lhs, const BigInt& rhs) { return !(lhs < rhs); }
+
+inline std::ostream& operator<<(std::ostream& out, const BigInt& val)
+{
+	out << val.str();
+	return out;
+}
+
+inline std::istream& operator>>(std::istream& in, BigInt& val)
+{
+	std::string str;
+	in >> str;
+	val = BigInt(str);
+	return in;
+}
+
+// Exact rational number, always kept reduced with a positive denominator.
+class BigRational
+{
+public:
+	BigRational() : m_num(), m_den(1) { }
+
+	template<typename T, class = typename std::enable_if<std::is_integral<T>::value>::type>
+	BigRational(T val) : m_num(val), m_den(1) { }
+
+	BigRational(BigInt num) : m_num(std::move(num)), m_den(1) { }
+
+	// Throws std::invalid_argument if den is zero.
+	BigRational(BigInt num, BigInt den)
+		: m_num(std::move(num))
+		, m_den(den.magnitude())
+	{
+		if (m_den.zero()) throw std::invalid_argument("Zero denominator");
+		if (den.negative()) m_num = -std::move(m_num);
+		reduce();
+	}
+
+	const BigInt& numerator() const { return m_num; }
+	const BigUint& denominator() const { return m_den; }
+
+	bool zero() const { return m_num.zero(); }
+	bool negative() const { return m_num.negative(); }
+
+	// "p/q", or just "p" for integers.
+	std::string str() const
+	{
+		return m_den == 1 ? m_num.str() : m_num.str() + "/" + m_den.str();
+	}
+
+	friend BigRational operator-(BigRational val)
+	{
+		val.m_num = -std::move(val.m_num);
+		return val;
+	}
+
+	friend BigRational& operator+=(BigRational& lhs, const BigRational& rhs)
+	{
+		lhs.m_num *= rhs.m_den;
+		lhs.m_num += rhs.m_num * lhs.m_den;
+		lhs.m_den *= rhs.m_den;
+		lhs.reduce();
+		return lhs;
+	}
+
+	friend BigRational& operator-=(BigRational& lhs, const BigRational& rhs)
+	{
+		lhs.m_num *= rhs.m_den;
+		lhs.m_num -= rhs.m_num * lhs.m_den;
+		lhs.m_den *= rhs.m_den;
+		lhs.reduce();
+		return lhs;
+	}
+
+	// Cross-cancels before multiplying, so the intermediate products are
+	// already reduced and no final gcd over the full product is needed.
+	friend BigRational& operator*=(BigRational& lhs, const BigRational& rhs)
+	{
+		const BigUint g1(gcd(lhs.m_num.magnitude(), rhs.m_den));
+		const BigUint g2(gcd(rhs.m_num.magnitude(), lhs.m_den));
+
+		lhs.m_num = (lhs.m_num / g1) * (rhs.m_num / g2);
+		lhs.m_den = (lhs.m_den / g2) * (rhs.m_den / g1);
+		return lhs;
+	}
+
+	// Throws std::invalid_argument on division by zero.
+	friend BigRational& operator/=(BigRational& lhs, const BigRational& rhs)
+	{
+		if (rhs.zero()) throw std::invalid_argument("Cannot divide by zero");
+
+		const BigUint g1(gcd(lhs.m_num.magnitude(), rhs.m_num.magnitude()));
+		const BigUint g2(gcd(lhs.m_den, rhs.m_den));
+
+		lhs.m_num = (lhs.m_num / g1) * BigInt(rhs.m_den / g2, rhs.negative());
+		lhs.m_den = (lhs.m_den / g2) * (rhs.m_num.magnitude() / g1);
+		return lhs;
+	}
+
+	friend bool operator==(const BigRational& lhs, const BigRational& rhs)
+	{
+		return lhs.m_num == rhs.m_num && lhs.m_den == rhs.m_den;
+	}
+
+	friend bool operator<(const BigRational& lhs, const BigRational& rhs)
+	{
+		return lhs.m_num * rhs.m_den < rhs.m_num * lhs.m_den;
+	}
+
+private:
+	void reduce()
+	{
+		const BigUint g(gcd(m_num.magnitude(), m_den));
+		if (g != 1)
+		{
+			m_num /= g;
+			m_den /= g;
+		}
+	}
+
+	BigInt m_num;
+	BigUint m_den;
+};
+
+inline BigRational operator+(BigRational lhs, const BigRational& rhs) { lhs += rhs; return lhs; }
+inline BigRational operator-(BigRational lhs, const BigRational& rhs) { lhs -= rhs; return lhs; }
+inline BigRational operator*(BigRational lhs, const BigRational& rhs) { lhs *= rhs; return lhs; }
+inline BigRational operator/(BigRational lhs, const BigRational& rhs) { lhs /= rhs; return lhs; }
+
+inline bool operator!=(const BigRational& lhs, const BigRational& rhs) { return !(lhs == rhs); }
+inline bool operator<=(const BigRational& lhs, const BigRational& rhs) { return !(rhs < lhs); }
+inline bool operator> (const BigRational& lhs, const BigRational& rhs) { return rhs < lhs; }
+inline bool operator>=(const BigRational& lhs, const BigRational& rhs) { return !(lhs < rhs); }
+
+inline std::ostream& operator<<(std::ostream& out, const BigRational& val)
+{
+	out << val.str();
+	return out;
+}
+
+namespace detail
+{
+
+// Low half of a * b; the high half goes to *hi.
+inline BigUint::Block mulWide(BigUint::Block a, BigUint::Block b, BigUint::Block* hi)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return _umul128(a, b, hi);
+#elif defined(__SIZEOF_INT128__)
+	const unsigned __int128 product(static_cast<unsigned __int128>(a) * b);
+	*hi = static_cast<BigUint::Block>(product >> 64);
+	return static_cast<BigUint::Block>(product);
+#else
+	const BigUint::Block mask(0xffffffffULL);
+	const BigUint::Block aLo(a & mask), aHi(a >> 32);
+	const BigUint::Block bLo(b & mask), bHi(b >> 32);
+
+	const BigUint::Block lolo(aLo * bLo);
+	const BigUint::Block mid1(aHi * bLo + (lolo >> 32));
+	const BigUint::Block mid2(aLo * bHi + (mid1 & mask));
+
+	*hi = aHi * bHi + (mid1 >> 32) + (mid2 >> 32);
+	return (mid2 << 32) | (lolo & mask);
+#endif
+}
+
+// Low half of a * b + c + d, which always fits into two blocks.
+inline BigUint::Block mulAdd(
+	BigUint::Block a, BigUint::Block b,
+	BigUint::Block c, BigUint::Block d,
+	BigUint::Block* hi)
+{
+	BigUint::Block h;
+	BigUint::Block lo(mulWide(a, b, &h));
+	lo += c;
+	h += lo < c;
+	lo += d;
+	h += lo < d;
+	*hi = h;
+	return lo;
+}
+
+}
+
+// Arithmetic modulo a fixed odd n > 1 in Montgomery form: x is represented by
+// x * R mod n, where R = 2^(bitsPerBlock * n.blockSize()).  Multiplication
+// then needs only limb products and no division, so build one context per
+// modulus and keep values in Montgomery form for as long as possible.
+//
+// All members are const and thread safe.
+class MontgomeryContext
+{
+public:
+	using Block = BigUint::Block;
+
+	// Throws std::invalid_argument if modulus is even or less than 3.
+	explicit MontgomeryContext(const BigUint& modulus);
+
+	const BigUint& modulus() const { return m_modulus; }
+
+	// Conversions between plain and Montgomery form.
+	BigUint to(const BigUint& val) const;
+	BigUint from(const BigUint& val) const;
+
+	// lhs = lhs * rhs, both operands in Montgomery form.
+	void mul(BigUint& lhs, const BigUint& rhs) const;
+
+	// base^exponent with base and result in Montgomery form.  Uses a sliding
+	// window whose width grows with the length of the exponent.
+	BigUint pow(const BigUint& base, const BigUint& exponent) const;
+
+private:
+	// out = a * b / R mod n for s-block operands.  scratch needs s + 2 blocks.
+	void multiply(const Block* a, const Block* b, Block* out, Block* scratch) const;
+
+	// Copies val, which must be less than n, into s blocks.
+	std::vector<Block> pad(const BigUint& val) const;
+	BigUint trim(const Block* limbs) const;
+
+	std::size_t m_size;
+	Block m_inverse;  // -n^-1 mod 2^bitsPerBlock
+	BigUint m_modulus;
+	std::vector<Block> m_n;
+	std::vector<Block> m_r2;  // R^2 mod n
+};
+
+inline MontgomeryContext::MontgomeryContext(const BigUint& modulus)
+	: m_size(modulus.blockSize())
+	, m_inverse(0)
+	, m_modulus(modulus)
+	, m_n(modulus.data().begin(), modulus.data().end())
+{
+	if (!(modulus.data().front() & 1) || modulus < 3)
+	{
+		throw std::invalid_argument("Montgomery modulus must be odd and > 1");
+	}
+
+	// Newton iteration doubles the number of correct low bits every step;
+	// n * n == 1 (mod 8) holds for any odd n, so start with three.
+	const Block n0(m_n.front());
+	Block inverse(n0);
+	for (int i(0); i < 5; ++i) inverse *= 2 - n0 * inverse;
+	m_inverse = 0 - inverse;
+
+	m_r2 = pad((BigUint(1) << (2 * BigUint::bitsPerBlock * m_size)) % m_modulus);
+}
+
+inline std::vector<MontgomeryContext::Block> MontgomeryContext::pad(const BigUint& val) const
+{
+	std::vector<Block> result(val.data().begin(), val.data().end());
+	result.resize(m_size, 0);
+	return result;
+}
+
+inline BigUint MontgomeryContext::trim(const Block* limbs) const
+{
+	std::size_t size(m_size);
+	while (size > 1 && !limbs[size - 1]) --size;
+	return BigUint(limbs, limbs + size);
+}
+
+inline void MontgomeryContext::multiply(
+	const Block* a, const Block* b, Block* out, Block* t) const
+{
+	// Coarsely integrated operand scanning (CIOS), Koc et al. 1996.
+	const std::size_t s(m_size);
+	const Block* n(m_n.data());
+	std::fill(t, t + s + 2, Block(0));
+
+	for (std::size_t i(0); i < s; ++i)
+	{
+		Block carry(0);
+		for (std::size_t j(0); j < s; ++j)
+		{
+			t[j] = detail::mulAdd(a[j], b[i], t[j], carry, &carry);
+		}
+		t[s] += carry;
+		t[s + 1] = t[s] < carry;
+
+		const Block m(t[0] * m_inverse);
+		detail::mulAdd(m, n[0], t[0], 0, &carry);
+		for (std::size_t j(1); j < s; ++j)
+		{
+			t[j - 1] = detail::mulAdd(m, n[j], t[j], carry, &carry);
+		}
+		t[s - 1] = t[s] + carry;
+		t[s] = t[s + 1] + (t[s - 1] < carry);
+	}
+
+	// Now t < 2n; subtract n once if needed.
+	bool subtract(t[s] != 0);
+	for (std::size_t j(s - 1); !subtract && j < s; --j)
+	{
+		if (t[j] != n[j])
+		{
+			subtract = t[j] > n[j];
+			break;
+		}
+		if (!j) subtract = true;
+	}
+
+	if (subtract)
+	{
+		bool borrow(false);
+		for (std::size_t j(0); j < s; ++j)
+		{
+			const Block old(t[j]);
+			t[j] = old - n[j] - static_cast<Block>(borrow);
+			borrow = old < n[j] || (borrow && old == n[j]);
+		}
+	}
+
+	std::copy(t, t + s, out);
+}
+
+inline BigUint MontgomeryContext::to(const BigUint& val) const
+{
+	std::vector<Block> v(pad(val < m_modulus ? val : val % m_modulus));
+	std::vector<Block> scratch(m_size + 2);
+	multiply(v.data(), m_r2.data(), v.data(), scratch.data());
+	return trim(v.data());
+}
+
+inline BigUint MontgomeryContext::from(const BigUint& val) const
+{
+	std::vector<Block> v(pad(val));
+	std::vector<Block> one(m_size, 0);
+	std::vector<Block> scratch(m_size + 2);
+	one.front() = 1;
+	multiply(v.data(), one.data(), v.data(), scratch.data());
+	return trim(v.data());
+}
+
+inline void MontgomeryContext::mul(BigUint& lhs, const BigUint& rhs) const
+{
+	std::vector<Block> a(pad(lhs));
+	std::vector<Block> scratch(m_size + 2);
+	if (&lhs == &rhs)
 	{
-		const BigUint::Block seed(0xc70f6907ULL);
-		const BigUint::Block m(0xc6a4a7935bd1e995ULL);
-		const BigUint::Block r(47);
+		multiply(a.data(), a.data(), a.data(), scratch.data());
+	}
+	else
+	{
+		const std::vector<Block> b(pad(rhs));
+		multiply(a.data(), b.data(), a.data(), scratch.data());
+	}
+	lhs = trim(a.data());
+}
+
+inline BigUint MontgomeryContext::pow(const BigUint& base, const BigUint& exponent) const
+{
+	const std::size_t s(m_size);
+	const auto& e(exponent.data());
+
+	std::size_t bit(e.size() * BigUint::bitsPerBlock - 1);
+	auto testBit = [&e](std::size_t i) {
+		return ((e[i / BigUint::bitsPerBlock] >> (i % BigUint::bitsPerBlock)) & 1) != 0;
+	};
+
+	if (exponent.zero()) return to(1);
+	while (!testBit(bit)) --bit;
+
+	const std::size_t window(
+		bit > 671 ? 6 : bit > 239 ? 5 : bit > 79 ? 4 : bit > 23 ? 3 : bit > 1 ? 2 : 1);
+
+	// table holds base^1, base^3, ..., base^(2^window - 1).
+	std::vector<Block> scratch(s + 2);
+	std::vector<Block> table(s << (window - 1));
+	std::vector<Block> acc(pad(base));
+	std::copy(acc.begin(), acc.end(), table.begin());
+	if (window > 1)
+	{
+		multiply(acc.data(), acc.data(), acc.data(), scratch.data());
+		for (std::size_t i(1); i < (std::size_t(1) << (window - 1)); ++i)
+		{
+			multiply(&table[(i - 1) * s], acc.data(), &table[i * s], scratch.data());
+		}
+	}
+
+	bool started(false);
+	for (std::size_t i(bit); i <= bit; )
+	{
+		if (!testBit(i))
+		{
+			multiply(acc.data(), acc.data(), acc.data(), scratch.data());
+			--i;
+			continue;
+		}
 
-		const auto& val(big.data());
+		// Longest window i..low that ends in a set bit.
+		std::size_t low(i + 1 >= window ? i + 1 - window : 0);
+		while (!testBit(low)) ++low;
 
-		BigUint::Block h(seed ^ (val.size() * sizeof(BigUint::Block) * m));
+		std::size_t value(0);
+		for (std::size_t j(i); j >= low && j <= i; --j)
+		{
+			value = (value << 1) | (testBit(j) ? 1 : 0);
+		}
 
-		const BigUint::Block* cur(val.data());
-		const BigUint::Block* end(val.data() + val.size());
+		const Block* entry(&table[(value >> 1) * s]);
+		if (started)
+		{
+			for (std::size_t j(low); j <= i; ++j)
+			{
+				multiply(acc.data(), acc.data(), acc.data(), scratch.data());
+			}
+			multiply(acc.data(), entry, acc.data(), scratch.data());
+		}
+		else
+		{
+			std::copy(entry, entry + s, acc.begin());
+			started = true;
+		}
+
+		i = low - 1;
+	}
 
-		BigUint::Block k(0);
+	return trim(acc.data());
+}
 
-		while (cur != end)
+// base^exponent mod modulus.  Odd moduli go through a MontgomeryContext, so when
+// many powers share a modulus it is cheaper to build the context once.
+inline BigUint powmod(const BigUint& base, const BigUint& exponent, const BigUint& modulus)
+{
+	if (modulus.zero()) throw std::invalid_argument("Cannot divide by zero");
+	if (modulus == 1) return 0;
+
+	if (modulus.data().front() & 1)
+	{
+		const MontgomeryContext ctx(modulus);
+		return ctx.from(ctx.pow(ctx.to(base), exponent));
+	}
+
+	BigUint result(1);
+	BigUint square(base % modulus);
+	const auto& e(exponent.data());
+	for (std::size_t block(0); block < e.size(); ++block)
+	{
+		for (std::size_t bit(0); bit < BigUint::bitsPerBlock; ++bit)
 		{
-			k = *cur++;
+			if ((e[block] >> bit) & 1)
+			{
+				result *= square;
+				result %= modulus;
+			}
+			if (block + 1 == e.size() && !(e[block] >> bit >> 1)) break;
+			square *= square;
+			square %= modulus;
+		}
+	}
+	return result;
+}
+
+// Hook for number_theory::factorization::impl::miller_rabin, found through
+// argument-dependent lookup.  n must be odd.
+inline MontgomeryContext make_modular_context(const BigUint& n)
+{
+	return MontgomeryContext(n);
+}
+
+namespace detail
+{
+
+// Full avalanche of a single word (the MurmurHash3 fmix64 finalizer).
+inline BigUint::Block hashAvalanche(BigUint::Block h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
 
-			k *= m;
-			k ^= k >> r;
-			k *= m;
+// Folds the 128-bit product of a and b down to 64 bits.
+inline BigUint::Block hashFold(BigUint::Block a, BigUint::Block b)
+{
+	BigUint::Block hi;
+	const BigUint::Block lo(mulWide(a, b, &hi));
+	return lo ^ hi;
+}
 
-			h ^= k;
-			h *= m;
+// 256 bytes of arbitrary keys for hashBlocks (splitmix64 output).
+//      [0, 19)  one window of four per stripe within a block of 16 stripes
+//      [20, 24) scramble keys, applied after every block
+//      [24, 28) keys of the last, possibly overlapping, stripe
+//      [28, 32) keys of the final merge and of the short path
+inline const BigUint::Block* hashSecret()
+{
+	alignas(32) static const BigUint::Block secret[32] = {
+		0xc0e16b163a85a4dcULL, 0x890acd8dd443c47cULL, 0xb3889d8a6dc47761ULL, 0x6a0398e528f0ae6aULL,
+		0x048344ece48a855eULL, 0xf175cfea21871330ULL, 0x391ceef02702c2fdULL, 0x4baf8cac4784cb12ULL,
+		0x3547744583a3f88eULL, 0xd9cf2b15c6b6c90eULL, 0x961facc76d5fe21cULL, 0x0094ab49d50f11f9ULL,
+		0xe3211e37bdbeb6dcULL, 0x62fe6c274ff3511aULL, 0x5ac30b329fdf0574ULL, 0x1450582c6b65b406ULL,
+		0x7a30fcc7888eb791ULL, 0x5540f5ba6a15576eULL, 0x16cef0559096d3e9ULL, 0x2cf8f14b06874899ULL,
+		0xc9c9263b6e2ce103ULL, 0xd6ff920b0a9faa6dULL, 0x53192697db998dc1ULL, 0x73ea9b9bc7cd18d7ULL,
+		0x102713f872c33fceULL, 0xf4183a0e5d2a033eULL, 0x71b63e307eebb517ULL, 0xda61f5713d036000ULL,
+		0x46eb7409ae691b21ULL, 0xb23ad691d6707698ULL, 0x67c8fe11d22fc4b9ULL, 0x7eb4661419481338ULL };
+	return secret;
+}
+
+// Adds four limbs into four independent accumulators: each lane gets the
+// 32x32->64 product of the halves of its keyed limb plus its neighbour's raw
+// limb, so no input bit is lost when a product happens to be zero.
+inline void hashStripe(
+	BigUint::Block (&acc)[4],
+	const BigUint::Block* in,
+	const BigUint::Block* key)
+{
+	const BigUint::Block mask(0xffffffffULL);
+	const BigUint::Block k0(in[0] ^ key[0]);
+	const BigUint::Block k1(in[1] ^ key[1]);
+	const BigUint::Block k2(in[2] ^ key[2]);
+	const BigUint::Block k3(in[3] ^ key[3]);
+	acc[0] += in[1] + (k0 & mask) * (k0 >> 32);
+	acc[1] += in[0] + (k1 & mask) * (k1 >> 32);
+	acc[2] += in[3] + (k2 & mask) * (k2 >> 32);
+	acc[3] += in[2] + (k3 & mask) * (k3 >> 32);
+}
+
+// Keeps the low bits of the products from dominating the accumulators.
+inline void hashScramble(BigUint::Block (&acc)[4], const BigUint::Block* key)
+{
+	for (std::size_t lane(0); lane < 4; ++lane)
+	{
+		acc[lane] ^= acc[lane] >> 47;
+		acc[lane] ^= key[lane];
+		acc[lane] *= 0x9e3779b1ULL;
+	}
+}
+
+// Hash of more than four limbs in the spirit of XXH3.  Four accumulators take
+// every fourth limb, so the loop is bound by multiplier throughput instead of
+// latency, and with AVX2 all four lanes live in one register.  Every stripe of
+// a block has its own keys, and blocks are separated by a scramble, so moving
+// limbs around changes the hash.
+inline std::size_t hashLongBlocks(const BigUint::Block* limbs, const std::size_t n)
+{
+	using Block = BigUint::Block;
+	const Block* const secret(hashSecret());
+
+	// Stripes before the last one, which always ends at the top limb and so
+	// overlaps the one before it when n is not a multiple of four.
+	const std::size_t stripes((n - 1) / 4);
+	const Block* const last(limbs + n - 4);
+
+	alignas(32) Block acc[4];
+
+#ifdef __AVX2__
+	{
+		const __m256i prime(_mm256_set1_epi64x(0x9e3779b1LL));
+		const __m256i scrambleKey(
+			_mm256_load_si256(reinterpret_cast<const __m256i*>(secret + 20)));
+		__m256i lanes(
+			_mm256_load_si256(reinterpret_cast<const __m256i*>(secret + 16)));
+
+		const auto stripe = [&lanes](const Block* in, const Block* key)
+		{
+			const __m256i data(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in)));
+			const __m256i keyed(_mm256_xor_si256(data,
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(key))));
+			const __m256i product(
+				_mm256_mul_epu32(keyed, _mm256_srli_epi64(keyed, 32)));
+			const __m256i swapped(
+				_mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+			lanes = _mm256_add_epi64(lanes, _mm256_add_epi64(product, swapped));
+		};
+
+		for (std::size_t i(0); i < stripes; ++i)
+		{
+			stripe(limbs + 4 * i, secret + i % 16);
+
+			if (i % 16 == 15)
+			{
+				lanes = _mm256_xor_si256(lanes, _mm256_srli_epi64(lanes, 47));
+				lanes = _mm256_xor_si256(lanes, scrambleKey);
+				lanes = _mm256_add_epi64(
+					_mm256_mul_epu32(lanes, prime),
+					_mm256_slli_epi64(
+						_mm256_mul_epu32(_mm256_srli_epi64(lanes, 32), prime), 32));
+			}
 		}
+		stripe(last, secret + 24);
+
+		_mm256_store_si256(reinterpret_cast<__m256i*>(acc), lanes);
+	}
+#else
+	std::copy(secret + 16, secret + 20, acc);
+
+	for (std::size_t i(0); i < stripes; ++i)
+	{
+		hashStripe(acc, limbs + 4 * i, secret + i % 16);
+		if (i % 16 == 15) hashScramble(acc, secret + 20);
+	}
+	hashStripe(acc, last, secret + 24);
+#endif
+
+	Block h(n * 0x9e3779b97f4a7c15ULL);
+	h += hashFold(acc[0] ^ secret[28], acc[1] ^ secret[29]);
+	h += hashFold(acc[2] ^ secret[30], acc[3] ^ secret[31]);
+	return static_cast<std::size_t>(hashAvalanche(h));
+}
+
+// A trivial() value goes through the avalanche alone, which is a bijection,
+// so distinct small values never collide.  Up to four limbs take one
+// 64x64->128 fold each.
+inline std::size_t hashBlocks(const BigUint::Block* limbs, const std::size_t n)
+{
+	using Block = BigUint::Block;
+	const Block* const secret(hashSecret());
 
-		h ^= h >> r;
-		h *= m;
-		h ^= h >> r;
+	if (n == 1) return static_cast<std::size_t>(hashAvalanche(limbs[0] ^ secret[28]));
+	if (n > 4) return hashLongBlocks(limbs, n);
 
-		return size_t(h);
+	// Each limb is keyed into two products, with its neighbours, and also
+	// added raw, as in hashStripe: a limb equal to its key zeroes a product
+	// but cannot erase the other limbs.
+	Block h(n * 0x9e3779b97f4a7c15ULL);
+	for (std::size_t i(0); i < n; ++i)
+	{
+		const std::size_t j(i + 1 == n ? 0 : i + 1);
+		h += limbs[j] + hashFold(limbs[i] ^ secret[28 + i], limbs[j] ^ secret[24 + i]);
+	}
+	return static_cast<std::size_t>(hashAvalanche(h));
+}
+
+} // namespace detail
+
+} // namespace big_integer
+} // namespace number_theory
+
+namespace std
+{
+
+template<> struct hash<number_theory::big_integer::BigUintView>
+{
+	using BigUintView = number_theory::big_integer::BigUintView;
+	std::size_t operator()(const BigUintView big) const
+	{
+		return number_theory::big_integer::detail::hashBlocks(
+			big.data(), big.blockSize());
+	}
+};
+
+// Equal to the hash of the corresponding BigUintView, so the two can share
+// lookups in a transparent container.
+template<> struct hash<number_theory::big_integer::BigUint>
+{
+	using BigUint = number_theory::big_integer::BigUint;
+	std::size_t operator()(const BigUint& big) const
+	{
+		return hash<number_theory::big_integer::BigUintView>()(big);
 	}
 };
 
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace number_theory {
+namespace bit_operations {
+
+// Number of zero bits above the highest set bit; 64 for zero.
+inline unsigned CountLeadingZeros(std::uint64_t x)
+{
+	if (x == 0)
+		return 64;
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return 63 - index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, static_cast<unsigned long>(x >> 32)))
+		return 31 - index;
+	_BitScanReverse(&index, static_cast<unsigned long>(x));
+	return 63 - index;
+#else
+	return static_cast<unsigned>(__builtin_clzll(x));
+#endif
+}
+
+// Number of zero bits below the lowest set bit; 64 for zero.
+inline unsigned CountTrailingZeros(std::uint64_t x)
+{
+	if (x == 0)
+		return 64;
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return index;
+#elif defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, static_cast<unsigned long>(x)))
+		return index;
+	_BitScanForward(&index, static_cast<unsigned long>(x >> 32));
+	return 32 + index;
+#else
+	return static_cast<unsigned>(__builtin_ctzll(x));
+#endif
+}
+
+inline unsigned PopCount(std::uint64_t x)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<unsigned>(__popcnt64(x));
+#elif defined(_MSC_VER)
+	x = x - ((x >> 1) & 0x5555555555555555ULL);
+	x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+	return static_cast<unsigned>((x * 0x0101010101010101ULL) >> 56);
+#else
+	return static_cast<unsigned>(__builtin_popcountll(x));
+#endif
+}
+
+// Number of significant bits; 0 for zero.
+inline unsigned BitLength(std::uint64_t x)
+{
+	return 64 - CountLeadingZeros(x);
+}
+
+// floor(sqrt(x)), exact over the whole range (a plain double sqrt is not once
+// x no longer fits into the mantissa).
+inline std::uint64_t IntegerSqrt(std::uint64_t x)
+{
+	std::uint64_t r = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(x)));
+	if (r > 0xffffffffULL)
+		r = 0xffffffffULL;
+	while (r * r > x)
+		--r;
+	while (r < 0xffffffffULL && (r + 1) * (r + 1) <= x)
+		++r;
+	return r;
+}
+
+}  // namespace bit_operations
+}  // namespace number_theory
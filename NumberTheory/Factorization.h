@@ -7,6 +7,8 @@
 #include <vector>
 #include <type_traits>
 
+#include "BitOperations.h"
+
 namespace number_theory {
 namespace factorization {
 
@@ -71,7 +73,7 @@ inline T sq_root(const T & n)
 }
 
 template <class T>
-inline unsigned bits_in_number(T n)
+inline unsigned bits_in_number(T n, std::false_type /* is_integral */)
 {
 	if (n == 0)
 		return 1;
@@ -84,6 +86,21 @@ inline unsigned bits_in_number(T n)
 	return result;
 }
 
+template <class T>
+inline unsigned bits_in_number(T n, std::true_type /* is_integral */)
+{
+	if (n == 0)
+		return 1;
+	return bit_operations::BitLength(
+		static_cast<typename std::make_unsigned<T>::type>(n));
+}
+
+template <class T>
+inline unsigned bits_in_number(T n)
+{
+	return bits_in_number(n, std::is_integral<T>());
+}
+
 template <class T>
 inline bool test_bit(const T & n, unsigned k)
 {
@@ -173,6 +190,31 @@ inline T powmod(T a, T2 k, const T & n)
 	return res;
 }
 
+// Modular arithmetic with a fixed modulus, as used by miller_rabin.  Values are
+// converted into the context's representation with to() and back with from();
+// mul() and pow() work on converted values.  Types with a faster scheme (e.g.
+// Montgomery form for big integers) provide their own make_modular_context,
+// which is picked up through argument-dependent lookup.
+template <class T>
+class PlainModularContext
+{
+public:
+	explicit PlainModularContext(const T & n) : n_(n) {}
+	T to(const T & a) const { return a; }
+	T from(const T & a) const { return a; }
+	void mul(T & a, const T & b) const { mulmod(a, b, n_); }
+	template <class T2>
+	T pow(const T & a, const T2 & k) const { return powmod(a, k, n_); }
+private:
+	T n_;
+};
+
+template <class T>
+inline PlainModularContext<T> make_modular_context(const T & n)
+{
+	return PlainModularContext<T>(n);
+}
+
 template <class T>
 inline void transform_num(T n, T & p, T & q)
 {
@@ -249,7 +291,7 @@ inline const std::vector<T> & get_primes(const T & b, T2 & pi)
 		for (T cur = first; cur <= b; ++++cur)
 		{
 			bool cur_is_prime = true;
-			for (std::vector<T>::const_iterator iter = primes.begin(), end = primes.end();
+			for (typename std::vector<T>::const_iterator iter = primes.begin(), end = primes.end();
 				iter != end; ++iter)
 			{
 				const T & div = *iter;
@@ -287,7 +329,7 @@ inline T2 prime_div_trivial(const T & n, T2 m)
 	T2 pi;
 	const std::vector<T2> & primes = get_primes(m, pi);
 
-	for (std::vector<T2>::const_iterator iter = primes.begin(), end = primes.end();
+	for (typename std::vector<T2>::const_iterator iter = primes.begin(), end = primes.end();
 		iter != end; ++iter)
 	{
 		const T2 & div = *iter;
@@ -324,14 +366,18 @@ inline bool miller_rabin(T n, T2 b)
 	T p, q;
 	transform_num(n_1, p, q);
 
-	T rem = powmod(T(b), q, n);
-	if (rem == 1 || rem == n_1)
+	const auto context = make_modular_context(n);
+	const T one = context.to(T(1));
+	const T minus_one = context.to(n_1);
+
+	T rem = context.pow(context.to(T(b)), q);
+	if (rem == one || rem == minus_one)
 		return true;
 
 	for (T i = 1; i < p; i++)
 	{
-		mulmod(rem, rem, n);
-		if (rem == n_1)
+		context.mul(rem, rem);
+		if (rem == minus_one)
 			return true;
 	}
 
@@ -440,7 +486,7 @@ inline T pollard_monte_carlo(T n, unsigned m = 100)
 		for (T prime = 5; prime <= static_cast<T>(m); ++++prime)
 		{
 			bool is_prime = true;
-			for (std::vector<T>::const_iterator iter = primes.begin(), end = primes.end();
+			for (typename std::vector<T>::const_iterator iter = primes.begin(), end = primes.end();
 				iter != end; ++iter)
 			{
 				T div = *iter;
@@ -507,7 +553,7 @@ bool IsPrime(T n)
 	if (div > 1)
 		return false;
 
-	for (T i = 2; (static_cast<T>(1) << i) <= n; ++i) {
+	for (unsigned i = 2; (static_cast<T>(1) << i) <= n; ++i) {
 		if (!impl::miller_rabin(n, i))
 			return false;
 	}
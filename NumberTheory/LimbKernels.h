@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Loops over little-endian arrays of 64-bit limbs, the building blocks of
+// BigUint arithmetic.  Add and subtract use the carry flag directly through
+// _addcarry_u64 / _subborrow_u64 on x64; shifts and bitwise operations use
+// AVX2 when the compiler targets it (/arch:AVX2, -mavx2 or the pragmas in
+// CppMagic/OptimizationPragmas.h).  Everything has a portable fallback.
+
+namespace number_theory {
+namespace limb_kernels {
+
+using Limb = unsigned long long;
+
+// lhs[0, n) += rhs[0, n) + carry; returns the carry out (0 or 1).
+inline Limb AddLimbs(Limb* lhs, const Limb* rhs, std::size_t n, Limb carry = 0)
+{
+	std::size_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+	unsigned char c = static_cast<unsigned char>(carry);
+	for (; i + 4 <= n; i += 4) {
+		c = _addcarry_u64(c, lhs[i], rhs[i], &lhs[i]);
+		c = _addcarry_u64(c, lhs[i + 1], rhs[i + 1], &lhs[i + 1]);
+		c = _addcarry_u64(c, lhs[i + 2], rhs[i + 2], &lhs[i + 2]);
+		c = _addcarry_u64(c, lhs[i + 3], rhs[i + 3], &lhs[i + 3]);
+	}
+	for (; i < n; ++i)
+		c = _addcarry_u64(c, lhs[i], rhs[i], &lhs[i]);
+	return c;
+#else
+	for (; i < n; ++i) {
+		const Limb r = rhs[i];
+		const Limb sum = lhs[i] + r + carry;
+		carry = sum < r || (carry && sum == r);
+		lhs[i] = sum;
+	}
+	return carry;
+#endif
+}
+
+// lhs[0, n) -= rhs[0, n) + borrow; returns the borrow out (0 or 1).
+inline Limb SubLimbs(Limb* lhs, const Limb* rhs, std::size_t n, Limb borrow = 0)
+{
+	std::size_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+	unsigned char b = static_cast<unsigned char>(borrow);
+	for (; i + 4 <= n; i += 4) {
+		b = _subborrow_u64(b, lhs[i], rhs[i], &lhs[i]);
+		b = _subborrow_u64(b, lhs[i + 1], rhs[i + 1], &lhs[i + 1]);
+		b = _subborrow_u64(b, lhs[i + 2], rhs[i + 2], &lhs[i + 2]);
+		b = _subborrow_u64(b, lhs[i + 3], rhs[i + 3], &lhs[i + 3]);
+	}
+	for (; i < n; ++i)
+		b = _subborrow_u64(b, lhs[i], rhs[i], &lhs[i]);
+	return b;
+#else
+	for (; i < n; ++i) {
+		const Limb old = lhs[i];
+		const Limb r = rhs[i];
+		lhs[i] = old - r - borrow;
+		borrow = old < r || (borrow && old == r);
+	}
+	return borrow;
+#endif
+}
+
+// lhs[0, n) += carry; returns the carry out.  Stops as soon as it is absorbed.
+inline Limb PropagateCarry(Limb* lhs, std::size_t n, Limb carry)
+{
+	for (std::size_t i = 0; carry && i < n; ++i)
+		carry = (++lhs[i] == 0);
+	return carry;
+}
+
+// lhs[0, n) -= borrow; returns the borrow out.
+inline Limb PropagateBorrow(Limb* lhs, std::size_t n, Limb borrow)
+{
+	for (std::size_t i = 0; borrow && i < n; ++i)
+		borrow = (lhs[i]-- == 0);
+	return borrow;
+}
+
+// out[i] = (in[i] << bits) | (in[i - 1] >> (64 - bits)) with in[-1] = 0, for
+// 0 < bits < 64; returns the bits shifted out of in[n - 1].  Works from the
+// top down, so out may be equal to in or lie above it.
+inline Limb ShiftLeftLimbs(Limb* out, const Limb* in, std::size_t n, unsigned bits)
+{
+	if (n == 0)
+		return 0;
+	const unsigned back = 64 - bits;
+	const Limb result = in[n - 1] >> back;
+	std::size_t i = n - 1;
+#ifdef __AVX2__
+	const __m128i count = _mm_cvtsi32_si128(static_cast<int>(bits));
+	const __m128i countBack = _mm_cvtsi32_si128(static_cast<int>(back));
+	for (; i >= 4; i -= 4) {
+		const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i - 3));
+		const __m256i prev = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i - 4));
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(out + i - 3),
+			_mm256_or_si256(_mm256_sll_epi64(cur, count), _mm256_srl_epi64(prev, countBack)));
+	}
+#endif
+	for (; i > 0; --i)
+		out[i] = (in[i] << bits) | (in[i - 1] >> back);
+	out[0] = in[0] << bits;
+	return result;
+}
+
+// out[i] = (in[i] >> bits) | (in[i + 1] << (64 - bits)) with in[n] = high, for
+// 0 < bits < 64.  Works from the bottom up, so out may be equal to in or lie
+// below it.
+inline void ShiftRightLimbs(Limb* out, const Limb* in, std::size_t n, unsigned bits, Limb high = 0)
+{
+	if (n == 0)
+		return;
+	const unsigned back = 64 - bits;
+	std::size_t i = 0;
+#ifdef __AVX2__
+	const __m128i count = _mm_cvtsi32_si128(static_cast<int>(bits));
+	const __m128i countBack = _mm_cvtsi32_si128(static_cast<int>(back));
+	for (; i + 5 <= n; i += 4) {
+		const __m256i cur = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+		const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i + 1));
+		_mm256_storeu_si256(
+			reinterpret_cast<__m256i*>(out + i),
+			_mm256_or_si256(_mm256_srl_epi64(cur, count), _mm256_sll_epi64(next, countBack)));
+	}
+#endif
+	for (; i + 1 < n; ++i)
+		out[i] = (in[i] >> bits) | (in[i + 1] << back);
+	out[n - 1] = (in[n - 1] >> bits) | (high << back);
+}
+
+// lhs[0, n) &= rhs[0, n)
+inline void AndLimbs(Limb* lhs, const Limb* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+#ifdef __AVX2__
+	for (; i + 4 <= n; i += 4) {
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lhs + i), _mm256_and_si256(a, b));
+	}
+#endif
+	for (; i < n; ++i)
+		lhs[i] &= rhs[i];
+}
+
+// lhs[0, n) |= rhs[0, n)
+inline void OrLimbs(Limb* lhs, const Limb* rhs, std::size_t n)
+{
+	std::size_t i = 0;
+#ifdef __AVX2__
+	for (; i + 4 <= n; i += 4) {
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lhs + i), _mm256_or_si256(a, b));
+	}
+#endif
+	for (; i < n; ++i)
+		lhs[i] |= rhs[i];
+}
+
+// Compares two n-limb numbers, most significant limb first, like memcmp:
+// negative, zero or positive.
+inline int CompareLimbs(const Limb* lhs, const Limb* rhs, std::size_t n)
+{
+	std::size_t i = n;
+#ifdef __AVX2__
+	// Skip over equal runs four limbs at a time.
+	while (i >= 4) {
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i - 4));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i - 4));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi64(a, b)) != -1)
+			break;
+		i -= 4;
+	}
+#endif
+	while (i > 0) {
+		--i;
+		if (lhs[i] != rhs[i])
+			return lhs[i] < rhs[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+}  // namespace limb_kernels
+}  // namespace number_theory
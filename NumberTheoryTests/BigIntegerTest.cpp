@@ -17,6 +17,248 @@ public:
 		BigUint r("1000000000000");
 		Assert::AreEqual(std::string("1000000000000000000000000"), (l * r).str());
 	}
+
+	TEST_METHOD(TestBigIntegerMoveStealsBuffer)
+	{
+		BigUint big("123456789012345678901234567890");
+		const BigUint::Block* limbs = big.data().data();
+		BigUint moved(std::move(big));
+		Assert::IsTrue(limbs == moved.data().data());
+		Assert::IsTrue(big.zero());
+
+		BigUint small = 5;
+		small = std::move(moved);
+		Assert::IsTrue(limbs == small.data().data());
+		Assert::AreEqual(std::string("123456789012345678901234567890"), small.str());
+
+		BigUint inlined(std::move(small));
+		BigUint five = 5;
+		inlined = std::move(five);
+		Assert::IsTrue(five.zero());
+		Assert::AreEqual(std::string("5"), inlined.str());
+		BigUint copy(std::move(inlined));
+		Assert::IsTrue(inlined.zero());
+		Assert::AreEqual(std::string("5"), copy.str());
+		Assert::IsTrue(std::is_nothrow_move_constructible<BigUint>::value);
+		Assert::IsTrue(std::is_nothrow_move_assignable<BigUint>::value);
+		Assert::IsTrue(std::is_nothrow_move_constructible<BigInt>::value);
+	}
+
+	TEST_METHOD(TestBigIntegerFusedMultiplyAdd)
+	{
+		BigUint a("340282366920938463463374607431768211457"); // 2^128 + 1
+		BigUint b("18446744073709551617"); // 2^64 + 1
+		BigUint acc("1000");
+		addmul(acc, a, b);
+		Assert::AreEqual((a * b + 1000).str(), acc.str());
+		submul(acc, b, a);
+		Assert::AreEqual(std::string("1000"), acc.str());
+		Assert::AreEqual(
+			std::string("115792089237316195436125188479461269381622128245897773798625937599852154191873"),
+			(a * b * b + BigUint(0)).str());
+	}
+
+	TEST_METHOD(TestBigIntegerLimbPoolReusesBlocks)
+	{
+		const BigUint n("123456789012345678901234567890123456789");
+		const BigUint d("98765432109876543210");
+		const auto expected = n.divMod(d);
+
+		LimbPoolScope scope;
+		const auto& pool = detail::LimbPool::local();
+		n.divMod(d);
+		const std::size_t warm = pool.systemAllocations();
+		for (int i = 0; i < 100; ++i) {
+			auto qr = n.divMod(d);
+			Assert::IsTrue(qr.first == expected.first);
+			Assert::IsTrue(qr.second == expected.second);
+		}
+		Assert::AreEqual(warm, pool.systemAllocations());
+	}
+
+	TEST_METHOD(TestBigIntegerSubtractionUnderflowKeepsValue)
+	{
+		BigUint l("18446744073709551617"); // 2^64 + 1
+		Assert::ExpectException<std::underflow_error>([&l]() { l -= BigUint("18446744073709551618"); });
+		Assert::AreEqual(std::string("18446744073709551617"), l.str());
+	}
+
+	TEST_METHOD(TestSignedBigInt)
+	{
+		BigInt a("-1000000000000000000000");
+		BigInt b = 7;
+		Assert::AreEqual(std::string("-999999999999999999993"), (a + b).str());
+		Assert::AreEqual(std::string("1000000000000000000007"), (b - a).str());
+		Assert::AreEqual(std::string("-7000000000000000000000"), (a * b).str());
+		Assert::AreEqual(std::string("-142857142857142857142"), (a / b).str());
+		Assert::AreEqual(std::string("-6"), (a % b).str());
+		Assert::IsTrue(a < b);
+		Assert::IsTrue(-a > b);
+		Assert::IsFalse((a - a).negative());
+		Assert::AreEqual(std::string("-9223372036854775808"), BigInt(std::numeric_limits<long long>::min()).str());
+	}
+
+	TEST_METHOD(TestBigRational)
+	{
+		BigRational half(1, 2);
+		BigRational third(BigInt(-2), BigInt(-6));
+		Assert::AreEqual(std::string("1/3"), third.str());
+		Assert::AreEqual(std::string("5/6"), (half + third).str());
+		Assert::AreEqual(std::string("1/6"), (half - third).str());
+		Assert::AreEqual(std::string("1/6"), (half * third).str());
+		Assert::AreEqual(std::string("3/2"), (half / third).str());
+		Assert::AreEqual(std::string("1"), (half + half).str());
+		Assert::IsTrue(third < half);
+		Assert::ExpectException<std::invalid_argument>([&half]() { return half / BigRational(); });
+		Assert::AreEqual(std::string("6"), gcd(BigUint(48), BigUint(18)).str());
+	}
+
+	TEST_METHOD(TestMontgomeryPowmod)
+	{
+		const BigUint m127 = (BigUint(1) << 127) - 1;
+		const MontgomeryContext ctx(m127);
+		Assert::AreEqual(std::string("12345"), ctx.from(ctx.to(BigUint(12345))).str());
+		// Fermat: a^(p-1) == 1 (mod p).
+		Assert::AreEqual(std::string("1"), ctx.from(ctx.pow(ctx.to(3), m127 - 1)).str());
+		Assert::AreEqual(
+			std::string("437040587693519348442853615302493042351"),
+			powmod(BigUint(3), BigUint(1000), (BigUint(1) << 130) + 1).str());
+		Assert::AreEqual(
+			std::string("1152921504606846976"),
+			powmod(BigUint(2), BigUint(60), BigUint(1) << 64).str());
+		Assert::ExpectException<std::invalid_argument>([]() { MontgomeryContext even(BigUint(1) << 64); });
+	}
+
+	TEST_METHOD(TestBigIntegerRootsAndBits)
+	{
+		const BigUint n("340282366920938463463374607431768211456"); // 2^128
+		Assert::AreEqual(BigUint::Block(128), BigUint::log2(n));
+		Assert::AreEqual(BigUint::Block(127), BigUint::log2(n - 1));
+		Assert::AreEqual(BigUint::Block(128), BigUint::trailingZeros(n));
+		Assert::AreEqual(BigUint::Block(128), BigUint::popCount(n - 1));
+		Assert::AreEqual(std::string("18446744073709551616"), BigUint::sqrt(n).str());
+		Assert::AreEqual(std::string("18446744073709551615"), BigUint::sqrt(n - 1).str());
+		Assert::AreEqual(std::string("6981463658331"), BigUint::nthRoot(n, 3).str());
+		Assert::AreEqual(std::string("65535"), BigUint::nthRoot(n - 1, 8).str());
+
+		BigUint root;
+		BigUint::Block exponent = 0;
+		Assert::IsTrue(BigUint::perfectPower(n, &root, &exponent));
+		Assert::AreEqual(std::string("2"), root.str());
+		Assert::AreEqual(BigUint::Block(128), exponent);
+		Assert::IsTrue(BigUint::perfectPower(BigUint::pow(BigUint("1000000007"), 6), &root, &exponent));
+		Assert::AreEqual(std::string("1000000007"), root.str());
+		Assert::AreEqual(BigUint::Block(6), exponent);
+		Assert::IsFalse(BigUint::perfectPower(n + 1));
+	}
+
+	TEST_METHOD(TestBigIntegerShiftsAcrossBlocks)
+	{
+		const BigUint n = (BigUint(1) << 128) + (BigUint(1) << 64) + 1;
+		Assert::IsTrue(n << 0 == n);
+		Assert::IsTrue(((n << 70) >> 70) == n);
+		Assert::AreEqual(std::string("18446744073709551617"), (n >> 64).str());
+		Assert::IsTrue((n >> 129).zero());
+		Assert::IsTrue((BigUint(0) << 1000).zero());
+
+		BigUint shifted(n);
+		shifted <<= 256;
+		Assert::IsTrue(shifted == (n << 256));
+		Assert::IsTrue(n < shifted);
+		shifted >>= 250;
+		Assert::IsTrue(shifted == (n << 6));
+		shifted |= BigUint(63);
+		shifted &= n << 6;
+		Assert::IsTrue(shifted == (n << 6));
+	}
+
+	TEST_METHOD(TestBigIntegerSerialization)
+	{
+		const BigUint n = (BigUint(1) << 1000) + 12345;
+		const std::string bytes = n.serialize();
+		Assert::AreEqual(n.serializedSize(), bytes.size());
+		Assert::AreEqual(std::size_t(1 + 16 * 8), bytes.size());
+		Assert::IsTrue(BigUint::deserialize(bytes) == n);
+		Assert::AreEqual(std::string(1, '\0'), BigUint(0).serialize());
+		Assert::IsTrue(BigUint::deserialize(BigUint(0).serialize()).zero());
+
+		const std::string two = bytes + BigUint(7).serialize();
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(two.data());
+		const unsigned char* const end = in + two.size();
+		Assert::IsTrue(BigUint::deserialize(in, end) == n);
+		Assert::IsTrue(BigUint::deserialize(in, end) == BigUint(7));
+		Assert::IsTrue(in == end);
+
+		Assert::ExpectException<std::invalid_argument>([&bytes]() { return BigUint::deserialize(bytes.substr(0, 100)); });
+		Assert::ExpectException<std::invalid_argument>([&bytes]() { return BigUint::deserialize(bytes + '\0'); });
+		Assert::ExpectException<std::invalid_argument>([]() { return BigUint::deserialize(std::string("\x01\0\0\0\0\0\0\0\0", 9)); });
+	}
+
+	TEST_METHOD(TestBigIntegerView)
+	{
+		const BigUint::Block limbs[] = { 5, 0, 1, 0, 0 };
+		const BigUintView view(limbs, limbs + 5);
+		const BigUint n = (BigUint(1) << 128) + 5;
+		Assert::AreEqual(std::size_t(3), view.blockSize());
+		Assert::IsTrue(view == n);
+		Assert::IsTrue(n == view.value());
+		Assert::IsTrue(BigUintView(limbs, limbs + 1) < view);
+		Assert::IsTrue(BigUintView(limbs, limbs).zero());
+		Assert::AreEqual(std::hash<BigUint>()(n), std::hash<BigUintView>()(view));
+		Assert::IsTrue(view * n == n * n);
+		BigUint product(3);
+		product *= view;
+		Assert::IsTrue(product == n * 3);
+		Assert::AreEqual(n.serialize().size(), view.serializedSize());
+	}
+
+	TEST_METHOD(TestBigIntegerHash)
+	{
+		const std::hash<BigUint> hasher;
+
+		// Trivial values go through a bijection, so they never collide.
+		std::vector<std::size_t> hashes;
+		for (BigUint::Block i = 0; i < 10000; ++i) hashes.push_back(hasher(BigUint(i << 20)));
+		std::sort(hashes.begin(), hashes.end());
+		Assert::IsTrue(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+
+		// Two to four limbs take the short path.  A limb equal to its key
+		// must not make the others irrelevant.
+		const BigUint::Block* secret = detail::hashSecret();
+		hashes.clear();
+		for (std::size_t n = 2; n <= 4; ++n) {
+			for (std::size_t keyed = 0; keyed < n; ++keyed) {
+				for (BigUint::Block other = 1; other <= 50; ++other) {
+					std::vector<BigUint::Block> short_limbs(n, 9);
+					short_limbs[keyed] = secret[28 + keyed];
+					short_limbs[(keyed + 1) % n] = other;
+					hashes.push_back(hasher(BigUint(short_limbs.data(), short_limbs.data() + n)));
+				}
+			}
+		}
+		const BigUint::Block pair[] = { 5, secret[29] };
+		const BigUint::Block other_pair[] = { 6, secret[29] };
+		Assert::AreNotEqual(hasher(BigUint(pair, pair + 2)), hasher(BigUint(other_pair, other_pair + 2)));
+		const BigUint::Block triple[] = { 5, secret[29], 9 };
+		const BigUint::Block other_triple[] = { 77777, secret[29], 9 };
+		Assert::AreNotEqual(hasher(BigUint(triple, triple + 3)), hasher(BigUint(other_triple, other_triple + 3)));
+		std::sort(hashes.begin(), hashes.end());
+		Assert::IsTrue(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+
+		// Long values take the four-lane path; every limb position matters.
+		std::vector<BigUint::Block> limbs(70, 0);
+		limbs.back() = 1;
+		hashes.clear();
+		for (std::size_t i = 0; i + 1 < limbs.size(); ++i) {
+			limbs[i] = 12345;
+			const BigUint n(limbs.data(), limbs.data() + limbs.size());
+			hashes.push_back(hasher(n));
+			Assert::AreEqual(hashes.back(), std::hash<BigUintView>()(BigUintView(limbs.data(), limbs.data() + limbs.size())));
+			limbs[i] = 0;
+		}
+		std::sort(hashes.begin(), hashes.end());
+		Assert::IsTrue(std::adjacent_find(hashes.begin(), hashes.end()) == hashes.end());
+	}
 };
 
 }  // namespace NumberTheoryTes
\ No newline at end of file
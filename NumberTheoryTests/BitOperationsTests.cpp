@@ -0,0 +1,43 @@
+#include "../NumberTheory/BitOperations.h"
+#include "CppUnitTest.h"
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace number_theory::bit_operations;
+
+namespace NumberTheoryTests {
+
+TEST_CLASS(BitOperationsTestCase)
+{
+public:
+
+	TEST_METHOD(TestBitScans)
+	{
+		Assert::AreEqual(64u, CountLeadingZeros(0));
+		Assert::AreEqual(64u, CountTrailingZeros(0));
+		Assert::AreEqual(0u, BitLength(0));
+		for (unsigned i = 0; i < 64; ++i) {
+			const std::uint64_t bit = 1ULL << i;
+			Assert::AreEqual(63 - i, CountLeadingZeros(bit));
+			Assert::AreEqual(i, CountTrailingZeros(bit));
+			Assert::AreEqual(i + 1, BitLength(bit | 1));
+			Assert::AreEqual(i + 1, PopCount(bit | (bit - 1)));
+		}
+	}
+
+	TEST_METHOD(TestIntegerSqrt)
+	{
+		Assert::AreEqual(0xffffffffULL, IntegerSqrt(~0ULL));
+		Assert::AreEqual(0xfffffffeULL, IntegerSqrt(0xfffffffe00000001ULL - 1));
+		Assert::AreEqual(0xffffffffULL, IntegerSqrt(0xfffffffe00000001ULL));
+		std::mt19937_64 gen;
+		for (int i = 0; i < 10000; ++i) {
+			const std::uint64_t x = gen() >> (gen() % 64);
+			const std::uint64_t r = IntegerSqrt(x);
+			Assert::IsTrue(r * r <= x);
+			Assert::IsTrue((r + 1) * (r + 1) > x || r == 0xffffffffULL);
+		}
+	}
+};
+
+}  // namespace NumberTheoryTests
@@ -1,3 +1,4 @@
+#include "../NumberTheory/BigInteger.h"
 #include "../NumberTheory/Factorization.h"
 #include "CppUnitTest.h"
 #include <random>
@@ -24,6 +25,18 @@ public:
 		}
 		Assert::AreEqual(1000000006, product);
 	}
+
+	TEST_METHOD(TestMillerRabinBigUint)
+	{
+		using number_theory::big_integer::BigUint;
+		const BigUint m521 = (BigUint(1) << 521) - 1;
+		const BigUint m607 = (BigUint(1) << 607) - 1;
+		Assert::IsTrue(impl::miller_rabin(m521, 2));
+		Assert::IsTrue(impl::miller_rabin(m607, 3));
+		Assert::IsFalse(impl::miller_rabin(m521 * m607, 3));
+		Assert::IsFalse(impl::miller_rabin((BigUint(1) << 523) - 1, 3));
+		Assert::IsFalse(impl::miller_rabin(BigUint(561), 2));
+	}
 };
 
 }  // namespace NumberTheoryTests
\ No newline at end of file
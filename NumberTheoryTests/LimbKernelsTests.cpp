@@ -0,0 +1,128 @@
+#include "../NumberTheory/LimbKernels.h"
+#include "CppUnitTest.h"
+#include <random>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace number_theory::limb_kernels;
+
+namespace NumberTheoryTests {
+
+TEST_CLASS(LimbKernelsTestCase)
+{
+public:
+
+	static std::vector<Limb> RandomLimbs(std::mt19937_64& gen, std::size_t n)
+	{
+		std::vector<Limb> v(n);
+		for (auto& x : v) {
+			switch (gen() % 4) {
+			case 0: x = 0; break;
+			case 1: x = ~0ULL; break;
+			default: x = gen();
+			}
+		}
+		return v;
+	}
+
+	TEST_METHOD(TestAddSubLimbs)
+	{
+		std::mt19937_64 gen;
+		for (std::size_t n = 0; n < 20; ++n) {
+			for (int it = 0; it < 50; ++it) {
+				const auto a = RandomLimbs(gen, n);
+				const auto b = RandomLimbs(gen, n);
+				const Limb carryIn = gen() % 2;
+
+				auto sum = a;
+				const Limb carry = AddLimbs(sum.data(), b.data(), n, carryIn);
+				Limb expectedCarry = carryIn;
+				for (std::size_t i = 0; i < n; ++i) {
+					const Limb s = a[i] + b[i];
+					const Limb c = s < a[i];
+					Assert::AreEqual(s + expectedCarry, sum[i]);
+					expectedCarry = c || (expectedCarry && s + 1 == 0);
+				}
+				Assert::AreEqual(expectedCarry, carry);
+
+				auto diff = sum;
+				Assert::AreEqual(carry, SubLimbs(diff.data(), b.data(), n, carryIn));
+				Assert::IsTrue(diff == a);
+			}
+		}
+	}
+
+	TEST_METHOD(TestPropagateCarry)
+	{
+		std::vector<Limb> v(5, ~0ULL);
+		Assert::AreEqual(1ULL, PropagateCarry(v.data(), v.size(), 1));
+		Assert::IsTrue(v == std::vector<Limb>(5, 0));
+		Assert::AreEqual(1ULL, PropagateBorrow(v.data(), v.size(), 1));
+		Assert::IsTrue(v == std::vector<Limb>(5, ~0ULL));
+		v[2] = 0;
+		Assert::AreEqual(0ULL, PropagateCarry(v.data(), v.size(), 1));
+		Assert::AreEqual(1ULL, v[2]);
+	}
+
+	TEST_METHOD(TestShiftLimbs)
+	{
+		std::mt19937_64 gen;
+		for (std::size_t n = 1; n < 20; ++n) {
+			for (unsigned bits = 1; bits < 64; bits += 7) {
+				const auto a = RandomLimbs(gen, n);
+				const Limb high = gen();
+
+				std::vector<Limb> left(n);
+				const Limb out = ShiftLeftLimbs(left.data(), a.data(), n, bits);
+				std::vector<Limb> right(n);
+				ShiftRightLimbs(right.data(), a.data(), n, bits, high);
+				for (std::size_t i = 0; i < n; ++i) {
+					const Limb below = i ? a[i - 1] >> (64 - bits) : 0;
+					const Limb above = i + 1 < n ? a[i + 1] : high;
+					Assert::AreEqual((a[i] << bits) | below, left[i]);
+					Assert::AreEqual((a[i] >> bits) | (above << (64 - bits)), right[i]);
+				}
+				Assert::AreEqual(a[n - 1] >> (64 - bits), out);
+
+				// In place, one limb apart, as BigUint's shift operators use them.
+				auto up = a;
+				up.push_back(0);
+				ShiftLeftLimbs(up.data() + 1, up.data(), n, bits);
+				Assert::IsTrue(std::equal(left.begin(), left.end(), up.begin() + 1));
+				ShiftRightLimbs(up.data(), up.data() + 1, n, bits);
+				for (std::size_t i = 0; i + 1 < n; ++i)
+					Assert::AreEqual(a[i], up[i]);
+				Assert::AreEqual(a[n - 1] & (~0ULL >> bits), up[n - 1]);
+			}
+		}
+	}
+
+	TEST_METHOD(TestBitwiseAndCompareLimbs)
+	{
+		std::mt19937_64 gen;
+		for (std::size_t n = 0; n < 20; ++n) {
+			const auto a = RandomLimbs(gen, n);
+			const auto b = RandomLimbs(gen, n);
+
+			auto both = a;
+			AndLimbs(both.data(), b.data(), n);
+			auto either = a;
+			OrLimbs(either.data(), b.data(), n);
+			for (std::size_t i = 0; i < n; ++i) {
+				Assert::AreEqual(a[i] & b[i], both[i]);
+				Assert::AreEqual(a[i] | b[i], either[i]);
+			}
+
+			Assert::AreEqual(0, CompareLimbs(a.data(), a.data(), n));
+			for (std::size_t i = 0; i < n; ++i) {
+				auto c = a;
+				c[i] ^= 1ULL << (gen() % 64);
+				const int expected = c[i] > a[i] ? 1 : -1;
+				Assert::AreEqual(expected, CompareLimbs(c.data(), a.data(), n));
+				Assert::AreEqual(-expected, CompareLimbs(a.data(), c.data(), n));
+			}
+		}
+	}
+};
+
+}  // namespace NumberTheoryTests